@@ -1,24 +1,92 @@
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <cstring>
+#include <iterator>
+#include <map>
 #include <memory>
+#include <memory_resource>
+#include <new>
+#include <mutex>
 #include <optional>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#ifdef __linux__
+#include <sys/mman.h>
+#define RTTYPES_HAS_MREMAP
+#endif
+
 namespace rttypes {
 namespace {
+    constexpr bool isPowerOfTwo(size_t value)
+    {
+        return value > 0 && (value & (value - 1)) == 0;
+    }
+
+    // The largest power of two that is not greater than value
+    constexpr size_t floorPowerOfTwo(size_t value)
+    {
+        size_t result = 1;
+        while (result <= value / 2) {
+            result *= 2;
+        }
+        return result;
+    }
+
+    // The smallest power of two that is not less than value
+    constexpr size_t ceilPowerOfTwo(size_t value)
+    {
+        const auto floor = floorPowerOfTwo(value);
+        if (floor >= value) {
+            return floor;
+        }
+        if (floor > SIZE_MAX / 2) {
+            throw std::overflow_error("Type size overflows size_t");
+        }
+        return floor * 2;
+    }
+
+    constexpr size_t checkedAdd(size_t a, size_t b)
+    {
+        if (a > SIZE_MAX - b) {
+            throw std::overflow_error("Type size overflows size_t");
+        }
+        return a + b;
+    }
+
+    constexpr size_t checkedMul(size_t a, size_t b)
+    {
+        if (b != 0 && a > SIZE_MAX / b) {
+            throw std::overflow_error("Type size overflows size_t");
+        }
+        return a * b;
+    }
+
     constexpr size_t padding(size_t offset, size_t alignment)
     {
-        const auto misalignment = offset & alignment;
-        return misalignment > 0 ? alignment - misalignment : 0;
+        assert(isPowerOfTwo(alignment));
+        return (alignment - (offset & (alignment - 1))) & (alignment - 1);
     }
 
     constexpr size_t align(size_t offset, size_t alignment)
     {
-        return offset + padding(offset, alignment);
+        return checkedAdd(offset, padding(offset, alignment));
     }
 
+    static_assert(padding(0, 8) == 0 && padding(1, 8) == 7 && padding(4, 8) == 4);
+    static_assert(padding(8, 8) == 0 && padding(9, 1) == 0 && padding(65, 64) == 63);
+    static_assert(align(12, 4) == 12 && align(13, 16) == 16 && align(100, 64) == 128);
+    static_assert(ceilPowerOfTwo(0) == 1 && ceilPowerOfTwo(1) == 1 && ceilPowerOfTwo(5) == 8);
+    static_assert(ceilPowerOfTwo(64) == 64 && ceilPowerOfTwo(65) == 128);
+
     template <typename T>
     auto offset(T* ptr, size_t offset)
     {
@@ -30,41 +98,312 @@ namespace {
     {
         return static_cast<const T*>(static_cast<const std::byte*>(ptr) + offset);
     }
+
+    void zeroStrided(void* ptr, size_t count, size_t size, size_t stride)
+    {
+        if (stride == size) {
+            std::memset(ptr, 0, count * size);
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            std::memset(offset(ptr, i * stride), 0, size);
+        }
+    }
+
+    size_t hashCombine(size_t seed, size_t value)
+    {
+        return seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+    }
+
+    void copyStrided(void* dest, const void* src, size_t count, size_t size, size_t stride)
+    {
+        if (stride == size) {
+            std::memcpy(dest, src, count * size);
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            std::memcpy(offset(dest, i * stride), offset(src, i * stride), size);
+        }
+    }
+
+    // The smallest page size of the platforms we care about. Mappings are multiples of it.
+    constexpr size_t pageSize = 4096;
+
+#ifdef RTTYPES_HAS_MREMAP
+    void* mapPages(size_t bytes)
+    {
+        const auto prot = PROT_READ | PROT_WRITE;
+        const auto ptr = mmap(nullptr, bytes, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    // The contents are kept (up to the smaller size), but the mapping may move
+    void* remapPages(void* ptr, size_t oldBytes, size_t newBytes)
+    {
+        const auto newPtr = mremap(ptr, oldBytes, newBytes, MREMAP_MAYMOVE);
+        if (newPtr == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        return newPtr;
+    }
+
+    void unmapPages(void* ptr, size_t bytes)
+    {
+        munmap(ptr, bytes);
+    }
+#endif
 }
 
+class Type;
+class TypeRegistry;
+
+// Types are immutable once they are shared. Compound types hold their children by TypePtr, so
+// copying them is shallow, and instances (like VectorData) refer to their type by a plain pointer.
+using TypePtr = std::shared_ptr<const Type>;
+
+// Properties of a type that allow skipping the virtual calls in favor of bulk memory operations
+enum TypeFlags : uint32_t {
+    NoFlags = 0,
+    ZeroConstructible = 1 << 0, // construct is equivalent to filling the object with zeros
+    TriviallyCopyable = 1 << 1, // copyData is equivalent to a memcpy
+    TriviallyDestructible = 1 << 2, // destruct does nothing
+    TriviallyRelocatable = 1 << 3, // relocate is equivalent to a memcpy
+    AllTypeFlags
+    = ZeroConstructible | TriviallyCopyable | TriviallyDestructible | TriviallyRelocatable,
+};
+
 class Type {
 public:
     Type() = default;
 
-    Type(size_t size, size_t alignment)
+    Type(size_t size, size_t alignment, uint32_t flags = NoFlags)
         : size_(size)
         , alignment_(alignment)
+        , flags_(flags)
     {
+        assert(isPowerOfTwo(alignment));
+        assert(size % alignment == 0);
     }
 
-    // This is needed so we can copy structs easily
-    virtual std::unique_ptr<Type> copy() const = 0;
+    virtual ~Type() = default;
+
+    // Structural hash and equality. Child types are compared by identity, which is enough for
+    // TypeRegistry, because it interns the children first.
+    virtual size_t hash() const = 0;
+    virtual bool equals(const Type& other) const = 0;
 
-    virtual void copyData(void* dest, const void* src) const = 0;
+    // Returns a copy of this type with all child types interned in registry or nullptr if
+    // this type has no children that are not interned already.
+    virtual TypePtr internChildren(TypeRegistry& /*registry*/) const { return nullptr; }
 
-    virtual void construct(void* ptr) const = 0;
-    virtual void destruct(void* ptr) const = 0;
+    // The *N functions operate on count objects, stride bytes apart, in a single virtual call.
+    // stride is at least size() and is larger than size() if the objects are e.g. fields of
+    // structs in an array. All ranges passed to the same call must not overlap.
+    virtual void constructN(void* ptr, size_t count, size_t stride) const = 0;
+    virtual void destructN(void* ptr, size_t count, size_t stride) const = 0;
+    // Copy-constructs the objects at src into uninitialized memory at dest
+    virtual void copyN(void* dest, const void* src, size_t count, size_t stride) const = 0;
+    // Move-constructs the objects at src into uninitialized memory at dest. The objects in src
+    // still have to be destructed.
+    virtual void moveN(void* dest, void* src, size_t count, size_t stride) const = 0;
+    // Like moveN, but also destructs the objects in src, leaving it uninitialized.
+    virtual void relocateN(void* dest, void* src, size_t count, size_t stride) const = 0;
+
+    void construct(void* ptr) const { constructN(ptr, 1, size_); }
+    void destruct(void* ptr) const { destructN(ptr, 1, size_); }
+    void copyData(void* dest, const void* src) const { copyN(dest, src, 1, size_); }
+    void moveData(void* dest, void* src) const { moveN(dest, src, 1, size_); }
+
+    // Relocates count contiguous objects
+    void relocate(void* dest, void* src, size_t count) const
+    {
+        relocateN(dest, src, count, size_);
+    }
 
     size_t size() const { return size_; } // including padding, like sizeof
     size_t alignment() const { return alignment_; }
 
+    uint32_t flags() const { return flags_; }
+    bool hasFlags(uint32_t flags) const { return (flags_ & flags) == flags; }
+    bool zeroConstructible() const { return hasFlags(ZeroConstructible); }
+    bool triviallyCopyable() const { return hasFlags(TriviallyCopyable); }
+    bool triviallyDestructible() const { return hasFlags(TriviallyDestructible); }
+    bool triviallyRelocatable() const { return hasFlags(TriviallyRelocatable); }
+
 protected:
     size_t size_ = 0;
-    size_t alignment_ = 0;
+    size_t alignment_ = 1;
+    uint32_t flags_ = NoFlags;
+};
+
+template <typename T>
+using EnableIfType = std::enable_if_t<std::is_base_of_v<Type, T>>;
+
+// Interns types structurally, so that all equal types share a single instance and comparing
+// interned types is a pointer comparison. Interned types are kept alive by the registry.
+class TypeRegistry {
+public:
+    static TypeRegistry& global()
+    {
+        static TypeRegistry registry;
+        return registry;
+    }
+
+    // Returns the canonical instance of type. Child types are interned first.
+    TypePtr intern(const TypePtr& type)
+    {
+        auto rebuilt = type->internChildren(*this);
+        const auto& candidate = rebuilt ? rebuilt : type;
+        std::lock_guard lock(mutex_);
+        return *types_.insert(candidate).first;
+    }
+
+    template <typename T, typename = EnableIfType<T>>
+    TypePtr intern(const T& type)
+    {
+        return intern(std::make_shared<T>(type));
+    }
+
+    bool isInterned(const Type* type) const
+    {
+        std::lock_guard lock(mutex_);
+        const auto it = types_.find(TypePtr(TypePtr {}, type));
+        return it != types_.end() && it->get() == type;
+    }
+
+    size_t size() const
+    {
+        std::lock_guard lock(mutex_);
+        return types_.size();
+    }
+
+private:
+    struct Hash {
+        size_t operator()(const TypePtr& type) const { return type->hash(); }
+    };
+
+    struct Equal {
+        bool operator()(const TypePtr& a, const TypePtr& b) const { return a->equals(*b); }
+    };
+
+    mutable std::mutex mutex_;
+    std::unordered_set<TypePtr, Hash, Equal> types_;
+};
+
+// Small fixed-size math types, packed like float arrays so that they can be passed to native
+// math libraries and the simd functions directly
+namespace math {
+    struct Vec2 {
+        float x, y;
+    };
+
+    struct Vec3 {
+        float x, y, z;
+    };
+
+    struct Vec4 {
+        float x, y, z, w;
+    };
+
+    struct Quat {
+        float x, y, z, w;
+    };
+
+    // Column-major
+    struct Mat4 {
+        float m[16];
+    };
+
+    static_assert(sizeof(Vec2) == 2 * sizeof(float) && sizeof(Vec3) == 3 * sizeof(float));
+    static_assert(sizeof(Vec4) == 4 * sizeof(float) && sizeof(Quat) == 4 * sizeof(float));
+    static_assert(sizeof(Mat4) == 16 * sizeof(float));
+}
+
+// Identifiers of the primitive types that are stable across builds and platforms, unlike
+// std::type_info, so they may be serialized. Never reorder or reuse them.
+enum class PrimitiveId : uint32_t {
+    None = 0,
+    Bool = 1,
+    Int8 = 2,
+    Int16 = 3,
+    Int32 = 4,
+    Int64 = 5,
+    UInt8 = 6,
+    UInt16 = 7,
+    UInt32 = 8,
+    UInt64 = 9,
+    Float32 = 10,
+    Float64 = 11,
+    Vec2 = 12,
+    Vec3 = 13,
+    Vec4 = 14,
+    Quat = 15,
+    Mat4 = 16,
 };
 
+template <typename T>
+inline constexpr PrimitiveId primitiveId = PrimitiveId::None;
+template <>
+inline constexpr PrimitiveId primitiveId<bool> = PrimitiveId::Bool;
+template <>
+inline constexpr PrimitiveId primitiveId<int8_t> = PrimitiveId::Int8;
+template <>
+inline constexpr PrimitiveId primitiveId<int16_t> = PrimitiveId::Int16;
+template <>
+inline constexpr PrimitiveId primitiveId<int32_t> = PrimitiveId::Int32;
+template <>
+inline constexpr PrimitiveId primitiveId<int64_t> = PrimitiveId::Int64;
+template <>
+inline constexpr PrimitiveId primitiveId<uint8_t> = PrimitiveId::UInt8;
+template <>
+inline constexpr PrimitiveId primitiveId<uint16_t> = PrimitiveId::UInt16;
+template <>
+inline constexpr PrimitiveId primitiveId<uint32_t> = PrimitiveId::UInt32;
+template <>
+inline constexpr PrimitiveId primitiveId<uint64_t> = PrimitiveId::UInt64;
+template <>
+inline constexpr PrimitiveId primitiveId<float> = PrimitiveId::Float32;
+template <>
+inline constexpr PrimitiveId primitiveId<double> = PrimitiveId::Float64;
+template <>
+inline constexpr PrimitiveId primitiveId<math::Vec2> = PrimitiveId::Vec2;
+template <>
+inline constexpr PrimitiveId primitiveId<math::Vec3> = PrimitiveId::Vec3;
+template <>
+inline constexpr PrimitiveId primitiveId<math::Vec4> = PrimitiveId::Vec4;
+template <>
+inline constexpr PrimitiveId primitiveId<math::Quat> = PrimitiveId::Quat;
+template <>
+inline constexpr PrimitiveId primitiveId<math::Mat4> = PrimitiveId::Mat4;
+
+template <typename T>
+constexpr uint32_t typeFlags()
+{
+    uint32_t flags = NoFlags;
+    // Value-initializing a trivial type zero-initializes it. This assumes that zero floats and
+    // null pointers are all zero bits, which is true on every platform we care about.
+    if (std::is_trivially_default_constructible_v<T>) {
+        flags |= ZeroConstructible;
+    }
+    if (std::is_trivially_copyable_v<T>) {
+        flags |= TriviallyCopyable | TriviallyRelocatable;
+    }
+    if (std::is_trivially_destructible_v<T>) {
+        flags |= TriviallyDestructible;
+    }
+    return flags;
+}
+
 template <typename T>
 class ConcreteType : public Type {
 public:
     using Underlying = T;
 
     ConcreteType()
-        : Type(sizeof(T), std::alignment_of_v<T>)
+        : Type(sizeof(T), std::alignment_of_v<T>, typeFlags<T>())
     {
     }
 
@@ -72,39 +411,245 @@ public:
 
     T& view(void* ptr) const { return *reinterpret_cast<T*>(ptr); }
 
-    std::unique_ptr<Type> copy() const override { return std::make_unique<ConcreteType>(*this); }
+    PrimitiveId id() const { return primitiveId<T>; }
+
+    size_t hash() const override
+    {
+        if constexpr (primitiveId<T> != PrimitiveId::None) {
+            return static_cast<size_t>(primitiveId<T>);
+        } else {
+            return typeid(T).hash_code();
+        }
+    }
+
+    bool equals(const Type& other) const override
+    {
+        return dynamic_cast<const ConcreteType*>(&other) != nullptr;
+    }
+
+    void constructN(void* ptr, size_t count, size_t stride) const override
+    {
+        if constexpr (std::is_trivially_default_constructible_v<T>) {
+            zeroStrided(ptr, count, sizeof(T), stride);
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                new (offset(ptr, i * stride)) T {};
+            }
+        }
+    }
+
+    void destructN(void* ptr, size_t count, size_t stride) const override
+    {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            for (size_t i = 0; i < count; ++i) {
+                at(ptr, i * stride).~T();
+            }
+        }
+    }
+
+    void copyN(void* dest, const void* src, size_t count, size_t stride) const override
+    {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            copyStrided(dest, src, count, sizeof(T), stride);
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                new (offset(dest, i * stride)) T(at(src, i * stride));
+            }
+        }
+    }
+
+    void moveN(void* dest, void* src, size_t count, size_t stride) const override
+    {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            copyStrided(dest, src, count, sizeof(T), stride);
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                new (offset(dest, i * stride)) T(std::move(at(src, i * stride)));
+            }
+        }
+    }
 
-    void copyData(void* dest, const void* src) const override
+    void relocateN(void* dest, void* src, size_t count, size_t stride) const override
     {
-        construct(dest);
-        view(dest) = *reinterpret_cast<const T*>(src);
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            copyStrided(dest, src, count, sizeof(T), stride);
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                auto& s = at(src, i * stride);
+                new (offset(dest, i * stride)) T(std::move(s));
+                s.~T();
+            }
+        }
     }
 
-    void construct(void* ptr) const override { new (ptr) T {}; }
-    void destruct(void* ptr) const override { reinterpret_cast<T*>(ptr)->~T(); }
+private:
+    static T& at(void* ptr, size_t off) { return *reinterpret_cast<T*>(offset(ptr, off)); }
+
+    static const T& at(const void* ptr, size_t off)
+    {
+        return *reinterpret_cast<const T*>(offset(ptr, off));
+    }
 };
 
+using Bool = ConcreteType<bool>;
+using Int8 = ConcreteType<int8_t>;
+using Int16 = ConcreteType<int16_t>;
+using Int32 = ConcreteType<int32_t>;
+using Int64 = ConcreteType<int64_t>;
+using UInt8 = ConcreteType<uint8_t>;
+using UInt16 = ConcreteType<uint16_t>;
+using UInt32 = ConcreteType<uint32_t>;
+using UInt64 = ConcreteType<uint64_t>;
 using Float32 = ConcreteType<float>;
+using Float64 = ConcreteType<double>;
+using Vec2 = ConcreteType<math::Vec2>;
+using Vec3 = ConcreteType<math::Vec3>;
+using Vec4 = ConcreteType<math::Vec4>;
+using Quat = ConcreteType<math::Quat>;
+using Mat4 = ConcreteType<math::Mat4>;
 using String = ConcreteType<std::string>;
 
-class Struct : public Type {
+// The instance of a primitive type interned in TypeRegistry::global(), e.g. to look up a
+// deserialized PrimitiveId. Returns nullptr for PrimitiveId::None and unknown ids.
+inline TypePtr primitiveType(PrimitiveId id)
+{
+    auto& registry = TypeRegistry::global();
+    switch (id) {
+    case PrimitiveId::None:
+        return nullptr;
+    case PrimitiveId::Bool:
+        return registry.intern(Bool {});
+    case PrimitiveId::Int8:
+        return registry.intern(Int8 {});
+    case PrimitiveId::Int16:
+        return registry.intern(Int16 {});
+    case PrimitiveId::Int32:
+        return registry.intern(Int32 {});
+    case PrimitiveId::Int64:
+        return registry.intern(Int64 {});
+    case PrimitiveId::UInt8:
+        return registry.intern(UInt8 {});
+    case PrimitiveId::UInt16:
+        return registry.intern(UInt16 {});
+    case PrimitiveId::UInt32:
+        return registry.intern(UInt32 {});
+    case PrimitiveId::UInt64:
+        return registry.intern(UInt64 {});
+    case PrimitiveId::Float32:
+        return registry.intern(Float32 {});
+    case PrimitiveId::Float64:
+        return registry.intern(Float64 {});
+    case PrimitiveId::Vec2:
+        return registry.intern(Vec2 {});
+    case PrimitiveId::Vec3:
+        return registry.intern(Vec3 {});
+    case PrimitiveId::Vec4:
+        return registry.intern(Vec4 {});
+    case PrimitiveId::Quat:
+        return registry.intern(Quat {});
+    case PrimitiveId::Mat4:
+        return registry.intern(Mat4 {});
+    }
+    return nullptr;
+}
+
+// A std::pmr::string, which allocates from the memory resource of the type
+class PmrString : public Type {
 public:
-    Struct() = default;
-    ~Struct() = default;
+    using Underlying = std::pmr::string;
+
+    PmrString(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : Type(sizeof(std::pmr::string), std::alignment_of_v<std::pmr::string>)
+        , resource_(resource)
+    {
+    }
+
+    std::pmr::string& view(void* ptr) const { return *reinterpret_cast<std::pmr::string*>(ptr); }
+
+    std::pmr::memory_resource* resource() const { return resource_; }
+
+    size_t hash() const override
+    {
+        const auto resourceHash = std::hash<std::pmr::memory_resource*> {}(resource_);
+        return hashCombine(typeid(PmrString).hash_code(), resourceHash);
+    }
+
+    bool equals(const Type& other) const override
+    {
+        const auto str = dynamic_cast<const PmrString*>(&other);
+        return str && str->resource_ == resource_;
+    }
+
+    void constructN(void* ptr, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            new (offset(ptr, i * stride)) std::pmr::string(resource_);
+        }
+    }
+
+    void destructN(void* ptr, size_t count, size_t stride) const override
+    {
+        using std::pmr::string;
+        for (size_t i = 0; i < count; ++i) {
+            at(ptr, i * stride).~string();
+        }
+    }
+
+    void copyN(void* dest, const void* src, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            const auto& str = *reinterpret_cast<const std::pmr::string*>(offset(src, i * stride));
+            new (offset(dest, i * stride)) std::pmr::string(str, resource_);
+        }
+    }
+
+    // Moving steals the buffer only if the source uses the same resource
+    void moveN(void* dest, void* src, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            auto& str = at(src, i * stride);
+            new (offset(dest, i * stride)) std::pmr::string(std::move(str), resource_);
+        }
+    }
 
-    Struct(const Struct& other)
-        : Type(other.size_, other.alignment_)
-        , currentOffset_(other.currentOffset_)
+    void relocateN(void* dest, void* src, size_t count, size_t stride) const override
     {
-        for (const auto& field : other.fields_) {
-            fields_.push_back(Field { field.name, field.type->copy(), field.offset });
+        using std::pmr::string;
+        moveN(dest, src, count, stride);
+        for (size_t i = 0; i < count; ++i) {
+            at(src, i * stride).~string();
         }
     }
 
+private:
+    static std::pmr::string& at(void* ptr, size_t off)
+    {
+        return *reinterpret_cast<std::pmr::string*>(offset(ptr, off));
+    }
+
+    std::pmr::memory_resource* resource_;
+};
+
+constexpr size_t cacheLineSize = 64;
+
+enum class LayoutPolicy {
+    DeclarationOrder, // Like a C++ struct
+    MinimizePadding, // Sort fields by alignment (descending)
+    AccessFrequency, // Sort fields by access hint (descending), then by alignment
+};
+
+class Struct : public Type {
+public:
+    Struct()
+        : Type(0, 1, AllTypeFlags)
+    {
+    }
+
     struct Field {
         std::string name;
-        std::unique_ptr<Type> type;
+        TypePtr type;
         size_t offset;
+        float accessHint = 0.0f; // Only used by LayoutPolicy::AccessFrequency
     };
 
     struct View {
@@ -115,204 +660,3923 @@ public:
         {
         }
 
-        void* fieldPtr(size_t index) { return offset(ptr_, struct_->fields_[index].offset); }
+        void* fieldPtr(size_t index) { return offset(ptr_, struct_->fields_[index].offset); }
+
+        void* fieldPtr(std::string_view name)
+        {
+            return fieldPtr(struct_->getFieldIndex(name).value());
+        }
+
+        template <typename T>
+        T& field(size_t index)
+        {
+            return *reinterpret_cast<T*>(fieldPtr(index));
+        }
+
+        template <typename T>
+        T& field(std::string_view name)
+        {
+            return field<T>(struct_->getFieldIndex(name).value());
+        }
+
+    private:
+        const Struct* struct_;
+        void* ptr_;
+    };
+
+    size_t addField(std::string name, TypePtr type)
+    {
+        currentOffset_ = align(currentOffset_, type->alignment());
+        const auto fieldSize = type->size();
+
+        alignment_ = std::max(alignment_, type->alignment());
+        flags_ &= type->flags();
+
+        fields_.push_back(Field { std::move(name), std::move(type), currentOffset_ });
+        currentOffset_ = checkedAdd(currentOffset_, fieldSize);
+        size_ = align(currentOffset_, alignment_);
+
+        if (fields_.size() * 2 > fieldIndex_.size()) {
+            rebuildFieldIndex();
+        } else {
+            insertFieldIndex(fields_.size() - 1);
+        }
+
+        return fields_.size() - 1;
+    }
+
+    // Makes a single shared copy of type
+    template <typename FieldType, typename = EnableIfType<FieldType>>
+    size_t addField(std::string name, const FieldType& type)
+    {
+        return addField(std::move(name), std::make_shared<FieldType>(type));
+    }
+
+    void setAccessHint(size_t index, float accessHint) { fields_[index].accessHint = accessHint; }
+
+    // Raises the alignment of the struct, which also pads its size to a multiple of alignment.
+    // Use cacheLineSize to keep rows that are written by different threads from false sharing.
+    void setMinAlignment(size_t alignment)
+    {
+        assert(isPowerOfTwo(alignment));
+        alignment_ = std::max(alignment_, alignment);
+        size_ = align(currentOffset_, alignment_);
+    }
+
+    // Reassigns the field offsets according to policy. Field indices and names stay the same,
+    // only the offsets change, so this must not be called for a struct with live instances.
+    void finalize(LayoutPolicy policy)
+    {
+        std::vector<size_t> order(fields_.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        const auto byAlignment = [this](size_t a, size_t b) {
+            return fields_[a].type->alignment() > fields_[b].type->alignment();
+        };
+        if (policy == LayoutPolicy::MinimizePadding) {
+            std::stable_sort(order.begin(), order.end(), byAlignment);
+        } else if (policy == LayoutPolicy::AccessFrequency) {
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                if (fields_[a].accessHint != fields_[b].accessHint) {
+                    return fields_[a].accessHint > fields_[b].accessHint;
+                }
+                return byAlignment(a, b);
+            });
+        }
+
+        currentOffset_ = 0;
+        for (const auto index : order) {
+            auto& field = fields_[index];
+            field.offset = align(currentOffset_, field.type->alignment());
+            currentOffset_ = checkedAdd(field.offset, field.type->size());
+        }
+        size_ = align(currentOffset_, alignment_);
+    }
+
+    // Bytes of padding between fields and at the end of the struct
+    size_t wastedBytes() const
+    {
+        size_t used = 0;
+        for (const auto& field : fields_) {
+            used += field.type->size();
+        }
+        return size_ - used;
+    }
+
+    // If multiple fields have the same name, this returns the first one
+    std::optional<size_t> getFieldIndex(std::string_view name) const
+    {
+        if (fieldIndex_.empty()) {
+            return std::nullopt;
+        }
+        const auto hash = std::hash<std::string_view> {}(name);
+        const auto mask = fieldIndex_.size() - 1;
+        // The table is at most half full, so there is always an empty slot to stop at
+        for (auto i = hash & mask;; i = (i + 1) & mask) {
+            const auto& slot = fieldIndex_[i];
+            if (slot.field == emptySlot) {
+                return std::nullopt;
+            }
+            if (slot.hash == hash && fields_[slot.field].name == name) {
+                return slot.field;
+            }
+        }
+    }
+
+    View view(void* ptr) const { return View(this, ptr); }
+    // ConstView view(const void* ptr) const { return View(this, ptr); }
+
+    size_t fieldCount() const { return fields_.size(); }
+    const Field& field(size_t index) const { return fields_[index]; }
+    const Field& field(std::string_view name) const { return fields_[getFieldIndex(name).value()]; }
+
+    size_t hash() const override
+    {
+        auto seed = hashCombine(typeid(Struct).hash_code(), size_);
+        for (const auto& field : fields_) {
+            seed = hashCombine(seed, std::hash<std::string> {}(field.name));
+            seed = hashCombine(seed, std::hash<const Type*> {}(field.type.get()));
+            seed = hashCombine(seed, field.offset);
+        }
+        return seed;
+    }
+
+    bool equals(const Type& other) const override
+    {
+        const auto st = dynamic_cast<const Struct*>(&other);
+        if (!st || st->size_ != size_ || st->alignment_ != alignment_
+            || st->fields_.size() != fields_.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < fields_.size(); ++i) {
+            const auto& a = fields_[i];
+            const auto& b = st->fields_[i];
+            if (a.name != b.name || a.type != b.type || a.offset != b.offset) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    TypePtr internChildren(TypeRegistry& registry) const override
+    {
+        std::shared_ptr<Struct> copy;
+        for (size_t i = 0; i < fields_.size(); ++i) {
+            auto interned = registry.intern(fields_[i].type);
+            if (interned != fields_[i].type) {
+                if (!copy) {
+                    copy = std::make_shared<Struct>(*this);
+                }
+                copy->fields_[i].type = std::move(interned);
+            }
+        }
+        return copy;
+    }
+
+    // These iterate field-major, so there is one virtual call per field, not per object and field
+
+    void constructN(void* ptr, size_t count, size_t stride) const override
+    {
+        if (zeroConstructible()) {
+            zeroStrided(ptr, count, size_, stride);
+            return;
+        }
+        for (const auto& field : fields_) {
+            field.type->constructN(offset(ptr, field.offset), count, stride);
+        }
+    }
+
+    void destructN(void* ptr, size_t count, size_t stride) const override
+    {
+        if (triviallyDestructible()) {
+            return;
+        }
+        for (const auto& field : fields_) {
+            field.type->destructN(offset(ptr, field.offset), count, stride);
+        }
+    }
+
+    void copyN(void* dest, const void* src, size_t count, size_t stride) const override
+    {
+        if (triviallyCopyable()) {
+            copyStrided(dest, src, count, size_, stride);
+            return;
+        }
+        for (const auto& field : fields_) {
+            field.type->copyN(offset(dest, field.offset), offset(src, field.offset), count, stride);
+        }
+    }
+
+    void moveN(void* dest, void* src, size_t count, size_t stride) const override
+    {
+        if (triviallyCopyable()) {
+            copyStrided(dest, src, count, size_, stride);
+            return;
+        }
+        for (const auto& field : fields_) {
+            field.type->moveN(offset(dest, field.offset), offset(src, field.offset), count, stride);
+        }
+    }
+
+    void relocateN(void* dest, void* src, size_t count, size_t stride) const override
+    {
+        if (triviallyRelocatable()) {
+            copyStrided(dest, src, count, size_, stride);
+            return;
+        }
+        for (const auto& field : fields_) {
+            field.type->relocateN(
+                offset(dest, field.offset), offset(src, field.offset), count, stride);
+        }
+    }
+
+private:
+    // Open addressing hash table (linear probing) from field name to field index
+    struct FieldIndexSlot {
+        size_t hash;
+        size_t field;
+    };
+
+    static constexpr size_t emptySlot = SIZE_MAX;
+
+    void insertFieldIndex(size_t field)
+    {
+        const auto hash = std::hash<std::string_view> {}(fields_[field].name);
+        const auto mask = fieldIndex_.size() - 1;
+        auto i = hash & mask;
+        while (fieldIndex_[i].field != emptySlot) {
+            i = (i + 1) & mask;
+        }
+        fieldIndex_[i] = FieldIndexSlot { hash, field };
+    }
+
+    void rebuildFieldIndex()
+    {
+        size_t capacity = 8;
+        while (capacity < fields_.size() * 2) {
+            capacity *= 2;
+        }
+        fieldIndex_.assign(capacity, FieldIndexSlot { 0, emptySlot });
+        // Insert in order, so duplicate names resolve to the first field
+        for (size_t i = 0; i < fields_.size(); ++i) {
+            insertFieldIndex(i);
+        }
+    }
+
+    std::vector<Field> fields_;
+    std::vector<FieldIndexSlot> fieldIndex_;
+    size_t currentOffset_ = 0;
+};
+
+// How a vector grows its buffer when it runs out of capacity. The default doubles the capacity,
+// like std::vector. While the elements are relocated, the old and the new buffer are alive at
+// the same time, so for large vectors a smaller factor or maxStepBytes bound both the slack and
+// the peak memory usage.
+struct GrowthPolicy {
+    // The new capacity is at least factor times the old one. 1 allocates exactly what is needed.
+    double factor = 2.0;
+    // If not 0, the capacity grows by at most this many bytes per step (or by what is needed)
+    size_t maxStepBytes = 0;
+    // Rounds allocations up to the size classes of common allocators (powers of two up to a
+    // page, then whole pages), so that the rounding slack of the allocator becomes capacity
+    bool roundToSizeClass = false;
+    // The capacity of the first allocation, unless more is needed. Use VectorData::reserve for
+    // a hint per instance.
+    size_t initialCapacity = 0;
+
+    // The capacity to grow to, when capacity elements of elementSize bytes are not enough to hold
+    // required elements
+    size_t grow(size_t capacity, size_t required, size_t elementSize) const
+    {
+        assert(required > capacity && factor >= 1.0);
+        if (elementSize == 0) {
+            return required;
+        }
+        auto result = std::max(required, initialCapacity);
+        const auto scaled = static_cast<double>(capacity) * factor;
+        if (scaled > static_cast<double>(result)) {
+            const auto limit = static_cast<double>(SIZE_MAX / elementSize);
+            result = scaled < limit ? static_cast<size_t>(scaled) : SIZE_MAX / elementSize;
+        }
+        if (maxStepBytes > 0) {
+            const auto maxStep = std::max<size_t>(maxStepBytes / elementSize, 1);
+            if (result - capacity > maxStep) {
+                result = std::max(required, capacity + maxStep);
+            }
+        }
+        if (roundToSizeClass) {
+            result = sizeClass(checkedMul(result, elementSize)) / elementSize;
+        }
+        return result;
+    }
+
+    static size_t sizeClass(size_t bytes)
+    {
+        if (bytes <= pageSize) {
+            return ceilPowerOfTwo(bytes);
+        }
+        return align(bytes, pageSize);
+    }
+
+    bool operator==(const GrowthPolicy& other) const
+    {
+        return factor == other.factor && maxStepBytes == other.maxStepBytes
+            && roundToSizeClass == other.roundToSizeClass
+            && initialCapacity == other.initialCapacity;
+    }
+
+    size_t hash() const
+    {
+        auto seed = std::hash<double> {}(factor);
+        seed = hashCombine(seed, maxStepBytes);
+        seed = hashCombine(seed, roundToSizeClass);
+        return hashCombine(seed, initialCapacity);
+    }
+};
+
+struct VectorOptions {
+    // Minimum alignment of the element buffer, e.g. 32 or 64 for aligned SIMD loads. The buffer
+    // is always aligned at least like the element type.
+    size_t alignment = 1;
+    // Where the element buffer is allocated from, e.g. a std::pmr::monotonic_buffer_resource to
+    // release all vectors of a level at once.
+    std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+    GrowthPolicy growth = {};
+    // VectorData buffers of at least this many bytes are mapped from the OS directly, so that
+    // growing them is a mremap, which moves page table entries instead of copying elements.
+    // Only applies to trivially relocatable elements, if resource is the new/delete resource
+    // and the platform has mremap. 0 disables it.
+    size_t mapThreshold = 1 << 20;
+
+    bool operator==(const VectorOptions& other) const
+    {
+        return alignment == other.alignment && resource == other.resource
+            && growth == other.growth && mapThreshold == other.mapThreshold;
+    }
+
+    size_t hash() const
+    {
+        auto seed = hashCombine(alignment, std::hash<std::pmr::memory_resource*> {}(resource));
+        seed = hashCombine(seed, growth.hash());
+        return hashCombine(seed, mapThreshold);
+    }
+};
+
+inline const VectorOptions& defaultVectorOptions()
+{
+    static const VectorOptions options;
+    return options;
+}
+
+// Operations on the size constructed elements of elementType at data, shared by VectorData and
+// SmallVectorData, which only differ in where data is stored. Room for new elements has to be
+// made before, and the size has to be updated after calling these.
+namespace {
+    std::byte* elementPtr(const Type* elementType, std::byte* data, size_t idx)
+    {
+        return data + idx * elementType->size();
+    }
+
+    // Default-constructs count elements at pos
+    void* constructElements(const Type* elementType, std::byte* data, size_t pos, size_t count)
+    {
+        const auto ptr = elementPtr(elementType, data, pos);
+        elementType->constructN(ptr, count, elementType->size());
+        return ptr;
+    }
+
+    // Constructs or destructs elements at the end, so that there are newSize
+    void resizeElements(const Type* elementType, std::byte* data, size_t size, size_t newSize)
+    {
+        if (newSize > size) {
+            constructElements(elementType, data, size, newSize - size);
+        } else if (newSize < size) {
+            elementType->destructN(
+                elementPtr(elementType, data, newSize), size - newSize, elementType->size());
+        }
+    }
+
+    // Copy-constructs count elements at pos from the contiguous objects at src
+    void* copyElements(
+        const Type* elementType, std::byte* data, size_t pos, const void* src, size_t count)
+    {
+        const auto ptr = elementPtr(elementType, data, pos);
+        if (count > 0) {
+            elementType->copyN(ptr, src, count, elementType->size());
+        }
+        return ptr;
+    }
+
+    // Relocates count elements from index src to index dest within data. relocateN does not
+    // allow overlapping ranges, so unless the type is trivially relocatable this moves chunks
+    // that are at most as large as the distance, starting at the end that is not overwritten.
+    void relocateOverlapping(
+        const Type* elementType, std::byte* data, size_t dest, size_t src, size_t count)
+    {
+        if (count == 0 || dest == src) {
+            return;
+        }
+        if (elementType->triviallyRelocatable()) {
+            std::memmove(elementPtr(elementType, data, dest), elementPtr(elementType, data, src),
+                count * elementType->size());
+            return;
+        }
+        const auto distance = dest > src ? dest - src : src - dest;
+        for (size_t done = 0; done < count;) {
+            const auto chunk = std::min(distance, count - done);
+            // Moving right, start at the back. Moving left, start at the front.
+            const auto first = dest > src ? count - done - chunk : done;
+            elementType->relocate(elementPtr(elementType, data, dest + first),
+                elementPtr(elementType, data, src + first), chunk);
+            done += chunk;
+        }
+    }
+
+    // Relocates all elements to newData and leaves gapCount uninitialized elements at gapPos in it
+    void relocateElements(const Type* elementType, std::byte* newData, std::byte* data,
+        size_t size, size_t gapPos, size_t gapCount)
+    {
+        if (gapPos > 0) {
+            elementType->relocate(newData, data, gapPos);
+        }
+        if (size > gapPos) {
+            elementType->relocate(elementPtr(elementType, newData, gapPos + gapCount),
+                elementPtr(elementType, data, gapPos), size - gapPos);
+        }
+    }
+
+    // Destructs count elements starting at pos and closes the gap, keeping the order
+    void eraseElements(
+        const Type* elementType, std::byte* data, size_t size, size_t pos, size_t count)
+    {
+        assert(pos + count <= size);
+        elementType->destructN(elementPtr(elementType, data, pos), count, elementType->size());
+        relocateOverlapping(elementType, data, pos, pos + count, size - pos - count);
+    }
+
+    // Destructs the element at idx and moves the last element into its place
+    void swapRemoveElement(const Type* elementType, std::byte* data, size_t size, size_t idx)
+    {
+        assert(idx < size);
+        elementType->destruct(elementPtr(elementType, data, idx));
+        if (idx != size - 1) {
+            elementType->relocate(
+                elementPtr(elementType, data, idx), elementPtr(elementType, data, size - 1), 1);
+        }
+    }
+}
+
+// VectorData owns nothing that points into itself, so it may be relocated with a memcpy.
+// It does not own its element type or options either, which have to outlive it (the Vector
+// it was constructed by owns them).
+class VectorData {
+public:
+    explicit VectorData(
+        const Type* elementType, const VectorOptions* options = &defaultVectorOptions())
+        : elementType_(elementType)
+        , options_(options)
+    {
+    }
+
+    // Steals the buffer. The moved-from vector is left empty, but keeps its element type.
+    VectorData(VectorData&& other) noexcept
+        : elementType_(other.elementType_)
+        , options_(other.options_)
+        , data_(other.data_)
+        , size_(other.size_)
+        , capacity_(other.capacity_)
+    {
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.capacity_ = 0;
+    }
+
+    ~VectorData()
+    {
+        resize(0);
+        deallocate(data_);
+    }
+
+    VectorData& operator=(const VectorData& other)
+    {
+        if (this == &other) {
+            return *this;
+        }
+        resize(0);
+        reserve(other.size_);
+        copyElements(elementType_, data_, 0, other.data_, other.size_);
+        size_ = other.size_;
+        return *this;
+    }
+
+    // Steals the buffer of other, which must have the same element type. This vector takes
+    // over the options of other, because they were used to allocate the buffer.
+    VectorData& operator=(VectorData&& other) noexcept
+    {
+        if (this == &other) {
+            return *this;
+        }
+        assert(elementType_->equals(*other.elementType_));
+        resize(0);
+        deallocate(data_);
+        options_ = std::exchange(other.options_, options_);
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        capacity_ = std::exchange(other.capacity_, 0);
+        return *this;
+    }
+
+    void* indexPtr(size_t idx) { return data_ + idx * elementType_->size(); }
+    const void* indexPtr(size_t idx) const { return data_ + idx * elementType_->size(); }
+
+    template <typename T>
+    T& index(size_t idx)
+    {
+        assert(sizeof(T) == elementType_->size());
+        assert(idx < size_);
+        return *reinterpret_cast<T*>(indexPtr(idx));
+    }
+
+    void grow(size_t num = 1) { resize(size_ + num); }
+
+    void resize(size_t newSize)
+    {
+        reserveForGrowth(newSize);
+        resizeElements(elementType_, data<std::byte>(), size_, newSize);
+        size_ = newSize;
+    }
+
+    void clear() { resize(0); }
+
+    void reserve(size_t newCapacity)
+    {
+        if (newCapacity > capacity_) {
+            reallocate(newCapacity);
+        }
+    }
+
+    void shrinkToFit()
+    {
+        if (size_ == 0) {
+            deallocate(data_);
+            data_ = nullptr;
+            capacity_ = 0;
+        } else if (size_ < capacity_) {
+            reallocate(size_);
+        }
+    }
+
+    // Default-constructs a new element at the end and returns a pointer to it
+    void* emplaceBack()
+    {
+        resize(size_ + 1);
+        return indexPtr(size_ - 1);
+    }
+
+    // Copy-constructs a new element at the end from src, which must not be an element of this
+    void* pushBack(const void* src)
+    {
+        reserveForGrowth(size_ + 1);
+        const auto ptr = copyElements(elementType_, data<std::byte>(), size_, src, 1);
+        size_++;
+        return ptr;
+    }
+
+    // Move-constructs a new element at the end from src, which still has to be destructed
+    void* pushBackMove(void* src)
+    {
+        reserveForGrowth(size_ + 1);
+        const auto ptr = indexPtr(size_);
+        elementType_->moveData(ptr, src);
+        size_++;
+        return ptr;
+    }
+
+    void popBack()
+    {
+        assert(size_ > 0);
+        resize(size_ - 1);
+    }
+
+    // Inserts count default-constructed elements before pos and returns a pointer to the first
+    void* insert(size_t pos, size_t count = 1)
+    {
+        openGap(pos, count);
+        return constructElements(elementType_, data<std::byte>(), pos, count);
+    }
+
+    // Inserts copies of the count contiguous objects at src before pos. src must not point into
+    // this vector.
+    void* insert(size_t pos, const void* src, size_t count)
+    {
+        openGap(pos, count);
+        return copyElements(elementType_, data<std::byte>(), pos, src, count);
+    }
+
+    // Removes count elements starting at pos and closes the gap, keeping the order
+    void erase(size_t pos, size_t count = 1)
+    {
+        eraseElements(elementType_, data<std::byte>(), size_, pos, count);
+        size_ -= count;
+    }
+
+    // Removes the element at idx in O(1) by moving the last element into its place
+    void swapRemove(size_t idx)
+    {
+        swapRemoveElement(elementType_, data<std::byte>(), size_, idx);
+        size_--;
+    }
+
+    template <typename T = void>
+    T* data()
+    {
+        return reinterpret_cast<T*>(data_);
+    }
+
+    template <typename T = void>
+    const T* data() const
+    {
+        return reinterpret_cast<const T*>(data_);
+    }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    size_t capacity() const { return capacity_; }
+
+    const Type* elementType() const { return elementType_; }
+
+private:
+    size_t bufferAlignment() const
+    {
+        return std::max(elementType_->alignment(), options_->alignment);
+    }
+
+    size_t grownCapacity(size_t required) const
+    {
+        return options_->growth.grow(capacity_, required, elementType_->size());
+    }
+
+    void reserveForGrowth(size_t newSize)
+    {
+        if (capacity_ < newSize) {
+            reallocate(grownCapacity(newSize));
+        }
+    }
+
+    // Whether a buffer of capacity elements is (or would be) mapped with mapPages. This only
+    // depends on the capacity, because the other conditions are the same for the whole lifetime
+    // of the buffer.
+    bool isMapped(size_t capacity) const
+    {
+#ifdef RTTYPES_HAS_MREMAP
+        return options_->mapThreshold > 0 && elementType_->triviallyRelocatable()
+            && options_->resource == std::pmr::new_delete_resource()
+            && bufferAlignment() <= pageSize
+            && capacity * elementType_->size() >= options_->mapThreshold;
+#else
+        (void)capacity;
+        return false;
+#endif
+    }
+
+    size_t mappedBytes(size_t capacity) const
+    {
+        return align(checkedMul(capacity, elementType_->size()), pageSize);
+    }
+
+    // Leaves gapCount uninitialized elements at gapPos in the new buffer
+    void reallocate(size_t newCapacity, size_t gapPos = 0, size_t gapCount = 0)
+    {
+        const auto elementSize = elementType_->size();
+        const auto bytes = checkedMul(newCapacity, elementSize);
+        std::byte* newData = nullptr;
+#ifdef RTTYPES_HAS_MREMAP
+        if (isMapped(newCapacity)) {
+            // Use the rest of the last page too
+            newCapacity = mappedBytes(newCapacity) / elementSize;
+            if (data_ && isMapped(capacity_)) {
+                // The elements are trivially relocatable, so only the gap has to be opened
+                data_ = static_cast<std::byte*>(
+                    remapPages(data_, mappedBytes(capacity_), mappedBytes(newCapacity)));
+                capacity_ = newCapacity;
+                relocateOverlapping(elementType_, data_, gapPos + gapCount, gapPos, size_ - gapPos);
+                return;
+            }
+            newData = static_cast<std::byte*>(mapPages(mappedBytes(newCapacity)));
+        }
+#endif
+        if (!newData) {
+            newData = static_cast<std::byte*>(
+                options_->resource->allocate(bytes, bufferAlignment()));
+        }
+        relocateElements(elementType_, newData, data_, size_, gapPos, gapCount);
+        deallocate(data_);
+        data_ = newData;
+        capacity_ = newCapacity;
+    }
+
+    // Makes room for count (uninitialized) elements at pos
+    void openGap(size_t pos, size_t count)
+    {
+        assert(pos <= size_);
+        const auto newSize = checkedAdd(size_, count);
+        if (capacity_ < newSize) {
+            reallocate(grownCapacity(newSize), pos, count);
+        } else {
+            relocateOverlapping(elementType_, data_, pos + count, pos, size_ - pos);
+        }
+        size_ = newSize;
+    }
+
+    void deallocate(std::byte* data)
+    {
+        if (!data) {
+            return;
+        }
+#ifdef RTTYPES_HAS_MREMAP
+        if (isMapped(capacity_)) {
+            unmapPages(data, mappedBytes(capacity_));
+            return;
+        }
+#endif
+        const auto bytes = capacity_ * elementType_->size();
+        options_->resource->deallocate(data, bytes, bufferAlignment());
+    }
+
+    const Type* elementType_;
+    const VectorOptions* options_;
+    std::byte* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0; // size of data_ is capacity_ * elementType_->size()
+};
+
+class Vector : public Type {
+public:
+    // Instances refer to the options of the Vector they were constructed by
+    Vector(TypePtr elementType, VectorOptions options = {})
+        : Type(sizeof(VectorData), std::alignment_of_v<VectorData>, TriviallyRelocatable)
+        , elementType_(std::move(elementType))
+        , options_(options)
+    {
+        assert(isPowerOfTwo(options_.alignment));
+    }
+
+    // Makes a single shared copy of elementType
+    template <typename ElementType, typename = EnableIfType<ElementType>>
+    Vector(const ElementType& elementType, VectorOptions options = {})
+        : Vector(std::make_shared<ElementType>(elementType), options)
+    {
+    }
+
+    const TypePtr& elementType() const { return elementType_; }
+    const VectorOptions& options() const { return options_; }
+
+    size_t hash() const override
+    {
+        auto seed = typeid(Vector).hash_code();
+        seed = hashCombine(seed, std::hash<const Type*> {}(elementType_.get()));
+        return hashCombine(seed, options_.hash());
+    }
+
+    bool equals(const Type& other) const override
+    {
+        const auto vec = dynamic_cast<const Vector*>(&other);
+        return vec && vec->elementType_ == elementType_ && vec->options_ == options_;
+    }
+
+    TypePtr internChildren(TypeRegistry& registry) const override
+    {
+        auto interned = registry.intern(elementType_);
+        if (interned == elementType_) {
+            return nullptr;
+        }
+        return std::make_shared<Vector>(std::move(interned), options_);
+    }
+
+    VectorData& view(void* ptr) const { return *reinterpret_cast<VectorData*>(ptr); }
+
+    void constructN(void* ptr, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            new (offset(ptr, i * stride)) VectorData { elementType_.get(), &options_ };
+        }
+    }
+
+    void destructN(void* ptr, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            at(ptr, i * stride).~VectorData();
+        }
+    }
+
+    void copyN(void* dest, const void* src, size_t count, size_t stride) const override
+    {
+        constructN(dest, count, stride);
+        for (size_t i = 0; i < count; ++i) {
+            at(dest, i * stride) = *reinterpret_cast<const VectorData*>(offset(src, i * stride));
+        }
+    }
+
+    void moveN(void* dest, void* src, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            new (offset(dest, i * stride)) VectorData(std::move(at(src, i * stride)));
+        }
+    }
+
+    void relocateN(void* dest, void* src, size_t count, size_t stride) const override
+    {
+        copyStrided(dest, src, count, sizeof(VectorData), stride);
+    }
+
+private:
+    static VectorData& at(void* ptr, size_t off)
+    {
+        return *reinterpret_cast<VectorData*>(offset(ptr, off));
+    }
+
+    TypePtr elementType_;
+    VectorOptions options_;
+};
+
+// count elements stored inline, e.g. as a field of a struct, like a native array. Unlike Vector
+// it needs no allocation or indirection, but the count is part of the type.
+class FixedArray : public Type {
+public:
+    FixedArray(TypePtr elementType, size_t count)
+        : Type(checkedMul(elementType->size(), count), elementType->alignment(),
+            elementType->flags())
+        , elementType_(std::move(elementType))
+        , count_(count)
+    {
+    }
+
+    // Makes a single shared copy of elementType
+    template <typename ElementType, typename = EnableIfType<ElementType>>
+    FixedArray(const ElementType& elementType, size_t count)
+        : FixedArray(std::make_shared<ElementType>(elementType), count)
+    {
+    }
+
+    const TypePtr& elementType() const { return elementType_; }
+    size_t count() const { return count_; }
+
+    void* indexPtr(void* ptr, size_t idx) const
+    {
+        assert(idx < count_);
+        return offset(ptr, idx * elementType_->size());
+    }
+
+    template <typename T>
+    T* data(void* ptr) const
+    {
+        assert(sizeof(T) == elementType_->size());
+        return reinterpret_cast<T*>(ptr);
+    }
+
+    size_t hash() const override
+    {
+        auto seed = typeid(FixedArray).hash_code();
+        seed = hashCombine(seed, std::hash<const Type*> {}(elementType_.get()));
+        return hashCombine(seed, count_);
+    }
+
+    bool equals(const Type& other) const override
+    {
+        const auto arr = dynamic_cast<const FixedArray*>(&other);
+        return arr && arr->elementType_ == elementType_ && arr->count_ == count_;
+    }
+
+    TypePtr internChildren(TypeRegistry& registry) const override
+    {
+        auto interned = registry.intern(elementType_);
+        if (interned == elementType_) {
+            return nullptr;
+        }
+        return std::make_shared<FixedArray>(std::move(interned), count_);
+    }
+
+    // If the arrays are contiguous, all their elements are too and are processed in a single
+    // call. Otherwise these iterate element-major, with one call per element index.
+
+    void constructN(void* ptr, size_t count, size_t stride) const override
+    {
+        if (zeroConstructible()) {
+            zeroStrided(ptr, count, size_, stride);
+            return;
+        }
+        const auto elementSize = elementType_->size();
+        if (stride == size_) {
+            elementType_->constructN(ptr, count * count_, elementSize);
+            return;
+        }
+        for (size_t i = 0; i < count_; ++i) {
+            elementType_->constructN(offset(ptr, i * elementSize), count, stride);
+        }
+    }
+
+    void destructN(void* ptr, size_t count, size_t stride) const override
+    {
+        if (triviallyDestructible()) {
+            return;
+        }
+        const auto elementSize = elementType_->size();
+        if (stride == size_) {
+            elementType_->destructN(ptr, count * count_, elementSize);
+            return;
+        }
+        for (size_t i = 0; i < count_; ++i) {
+            elementType_->destructN(offset(ptr, i * elementSize), count, stride);
+        }
+    }
+
+    void copyN(void* dest, const void* src, size_t count, size_t stride) const override
+    {
+        if (triviallyCopyable()) {
+            copyStrided(dest, src, count, size_, stride);
+            return;
+        }
+        const auto elementSize = elementType_->size();
+        if (stride == size_) {
+            elementType_->copyN(dest, src, count * count_, elementSize);
+            return;
+        }
+        for (size_t i = 0; i < count_; ++i) {
+            const auto off = i * elementSize;
+            elementType_->copyN(offset(dest, off), offset(src, off), count, stride);
+        }
+    }
+
+    void moveN(void* dest, void* src, size_t count, size_t stride) const override
+    {
+        if (triviallyCopyable()) {
+            copyStrided(dest, src, count, size_, stride);
+            return;
+        }
+        const auto elementSize = elementType_->size();
+        if (stride == size_) {
+            elementType_->moveN(dest, src, count * count_, elementSize);
+            return;
+        }
+        for (size_t i = 0; i < count_; ++i) {
+            const auto off = i * elementSize;
+            elementType_->moveN(offset(dest, off), offset(src, off), count, stride);
+        }
+    }
+
+    void relocateN(void* dest, void* src, size_t count, size_t stride) const override
+    {
+        if (triviallyRelocatable()) {
+            copyStrided(dest, src, count, size_, stride);
+            return;
+        }
+        const auto elementSize = elementType_->size();
+        if (stride == size_) {
+            elementType_->relocateN(dest, src, count * count_, elementSize);
+            return;
+        }
+        for (size_t i = 0; i < count_; ++i) {
+            const auto off = i * elementSize;
+            elementType_->relocateN(offset(dest, off), offset(src, off), count, stride);
+        }
+    }
+
+private:
+    TypePtr elementType_;
+    size_t count_;
+};
+
+// Like VectorData, but the first inlineCapacity elements are stored inline, right after the
+// header, and only larger vectors allocate from the options resource. Instances are therefore
+// larger than sizeof(SmallVectorData) and can only be constructed by a SmallVector type, which
+// has to outlive them. A vector stays on the heap once it spilled over, until shrinkToFit.
+class SmallVectorData {
+public:
+    SmallVectorData(const Type* elementType, size_t inlineCapacity, const VectorOptions* options)
+        : elementType_(elementType)
+        , options_(options)
+        , capacity_(inlineCapacity)
+        , inlineCapacity_(inlineCapacity)
+    {
+    }
+
+    // other must have the same type. It is left empty, but keeps its element type. Only inline
+    // elements are moved, a heap buffer is stolen.
+    SmallVectorData(SmallVectorData&& other) noexcept
+        : elementType_(other.elementType_)
+        , options_(other.options_)
+        , heap_(other.heap_)
+        , size_(other.size_)
+        , capacity_(other.capacity_)
+        , inlineCapacity_(other.inlineCapacity_)
+    {
+        if (!heap_ && size_ > 0) {
+            elementType_->relocate(inlineData(), other.inlineData(), size_);
+        }
+        other.heap_ = nullptr;
+        other.size_ = 0;
+        other.capacity_ = other.inlineCapacity_;
+    }
+
+    ~SmallVectorData()
+    {
+        resize(0);
+        deallocate(heap_);
+    }
+
+    SmallVectorData& operator=(const SmallVectorData& other)
+    {
+        if (this == &other) {
+            return *this;
+        }
+        resize(0);
+        reserve(other.size_);
+        copyElements(elementType_, data<std::byte>(), 0, other.data(), other.size_);
+        size_ = other.size_;
+        return *this;
+    }
+
+    // other must have an equal type, so that the inline elements are at the same offset
+    SmallVectorData& operator=(SmallVectorData&& other) noexcept
+    {
+        if (this == &other) {
+            return *this;
+        }
+        assert(elementType_->equals(*other.elementType_));
+        assert(inlineCapacity_ == other.inlineCapacity_ && *options_ == *other.options_);
+        resize(0);
+        deallocate(heap_);
+        heap_ = std::exchange(other.heap_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        capacity_ = std::exchange(other.capacity_, other.inlineCapacity_);
+        if (!heap_ && size_ > 0) {
+            elementType_->relocate(inlineData(), other.inlineData(), size_);
+        }
+        return *this;
+    }
+
+    // The offset of the inline elements relative to the start of the vector
+    static size_t inlineOffset(const Type* elementType, const VectorOptions& options)
+    {
+        return align(sizeof(SmallVectorData), bufferAlignment(elementType, options));
+    }
+
+    static size_t bufferAlignment(const Type* elementType, const VectorOptions& options)
+    {
+        return std::max(elementType->alignment(), options.alignment);
+    }
+
+    void* indexPtr(size_t idx) { return data<std::byte>() + idx * elementType_->size(); }
+
+    const void* indexPtr(size_t idx) const
+    {
+        return data<std::byte>() + idx * elementType_->size();
+    }
+
+    template <typename T>
+    T& index(size_t idx)
+    {
+        assert(sizeof(T) == elementType_->size());
+        assert(idx < size_);
+        return *reinterpret_cast<T*>(indexPtr(idx));
+    }
+
+    void grow(size_t num = 1) { resize(size_ + num); }
+
+    void resize(size_t newSize)
+    {
+        reserveForGrowth(newSize);
+        resizeElements(elementType_, data<std::byte>(), size_, newSize);
+        size_ = newSize;
+    }
+
+    void clear() { resize(0); }
+
+    void reserve(size_t newCapacity)
+    {
+        if (newCapacity > capacity_) {
+            reallocate(newCapacity);
+        }
+    }
+
+    // Moves the elements back inline if they fit
+    void shrinkToFit()
+    {
+        if (!heap_ || size_ == capacity_) {
+            return;
+        }
+        if (size_ <= inlineCapacity_) {
+            if (size_ > 0) {
+                elementType_->relocate(inlineData(), heap_, size_);
+            }
+            deallocate(heap_);
+            heap_ = nullptr;
+            capacity_ = inlineCapacity_;
+        } else {
+            reallocate(size_);
+        }
+    }
+
+    // Default-constructs a new element at the end and returns a pointer to it
+    void* emplaceBack()
+    {
+        resize(size_ + 1);
+        return indexPtr(size_ - 1);
+    }
+
+    // Copy-constructs a new element at the end from src, which must not be an element of this
+    void* pushBack(const void* src)
+    {
+        reserveForGrowth(size_ + 1);
+        const auto ptr = copyElements(elementType_, data<std::byte>(), size_, src, 1);
+        size_++;
+        return ptr;
+    }
+
+    // Move-constructs a new element at the end from src, which still has to be destructed
+    void* pushBackMove(void* src)
+    {
+        reserveForGrowth(size_ + 1);
+        const auto ptr = indexPtr(size_);
+        elementType_->moveData(ptr, src);
+        size_++;
+        return ptr;
+    }
+
+    void popBack()
+    {
+        assert(size_ > 0);
+        resize(size_ - 1);
+    }
+
+    // Inserts count default-constructed elements before pos and returns a pointer to the first
+    void* insert(size_t pos, size_t count = 1)
+    {
+        openGap(pos, count);
+        return constructElements(elementType_, data<std::byte>(), pos, count);
+    }
+
+    // Inserts copies of the count contiguous objects at src before pos. src must not point into
+    // this vector.
+    void* insert(size_t pos, const void* src, size_t count)
+    {
+        openGap(pos, count);
+        return copyElements(elementType_, data<std::byte>(), pos, src, count);
+    }
+
+    // Removes count elements starting at pos and closes the gap, keeping the order
+    void erase(size_t pos, size_t count = 1)
+    {
+        eraseElements(elementType_, data<std::byte>(), size_, pos, count);
+        size_ -= count;
+    }
+
+    // Removes the element at idx in O(1) by moving the last element into its place
+    void swapRemove(size_t idx)
+    {
+        swapRemoveElement(elementType_, data<std::byte>(), size_, idx);
+        size_--;
+    }
+
+    template <typename T = void>
+    T* data()
+    {
+        return reinterpret_cast<T*>(heap_ ? heap_ : inlineData());
+    }
+
+    template <typename T = void>
+    const T* data() const
+    {
+        return reinterpret_cast<const T*>(heap_ ? heap_ : inlineData());
+    }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    size_t capacity() const { return capacity_; }
+
+    size_t inlineCapacity() const { return inlineCapacity_; }
+
+    // True if the elements are stored inline
+    bool isInline() const { return heap_ == nullptr; }
+
+    const Type* elementType() const { return elementType_; }
+
+private:
+    // The inline elements are found relative to this, so that instances can be relocated with a
+    // memcpy (if the elements can be).
+    std::byte* inlineData()
+    {
+        return reinterpret_cast<std::byte*>(this) + inlineOffset(elementType_, *options_);
+    }
+
+    const std::byte* inlineData() const
+    {
+        return reinterpret_cast<const std::byte*>(this) + inlineOffset(elementType_, *options_);
+    }
+
+    size_t grownCapacity(size_t required) const
+    {
+        return options_->growth.grow(capacity_, required, elementType_->size());
+    }
+
+    void reserveForGrowth(size_t newSize)
+    {
+        if (capacity_ < newSize) {
+            reallocate(grownCapacity(newSize));
+        }
+    }
+
+    // Moves the elements to a new heap buffer and leaves gapCount uninitialized elements at
+    // gapPos in it
+    void reallocate(size_t newCapacity, size_t gapPos = 0, size_t gapCount = 0)
+    {
+        const auto elementSize = elementType_->size();
+        const auto bytes = checkedMul(newCapacity, elementSize);
+        const auto newData = static_cast<std::byte*>(
+            options_->resource->allocate(bytes, bufferAlignment(elementType_, *options_)));
+        relocateElements(elementType_, newData, data<std::byte>(), size_, gapPos, gapCount);
+        deallocate(heap_);
+        heap_ = newData;
+        capacity_ = newCapacity;
+    }
+
+    // Makes room for count (uninitialized) elements at pos
+    void openGap(size_t pos, size_t count)
+    {
+        assert(pos <= size_);
+        const auto newSize = checkedAdd(size_, count);
+        if (capacity_ < newSize) {
+            reallocate(grownCapacity(newSize), pos, count);
+        } else {
+            relocateOverlapping(elementType_, data<std::byte>(), pos + count, pos, size_ - pos);
+        }
+        size_ = newSize;
+    }
+
+    void deallocate(std::byte* data)
+    {
+        if (data) {
+            const auto bytes = capacity_ * elementType_->size();
+            options_->resource->deallocate(
+                data, bytes, bufferAlignment(elementType_, *options_));
+        }
+    }
+
+    const Type* elementType_;
+    const VectorOptions* options_;
+    std::byte* heap_ = nullptr; // nullptr while the elements are stored inline
+    size_t size_ = 0;
+    size_t capacity_;
+    size_t inlineCapacity_;
+};
+
+class SmallVector : public Type {
+public:
+    // Instances refer to the options of the SmallVector they were constructed by.
+    // options.alignment applies to the inline elements as well.
+    SmallVector(TypePtr elementType, size_t inlineCapacity, VectorOptions options = {})
+        : elementType_(std::move(elementType))
+        , inlineCapacity_(inlineCapacity)
+        , options_(options)
+    {
+        assert(isPowerOfTwo(options_.alignment));
+        const auto inlineOffset = SmallVectorData::inlineOffset(elementType_.get(), options_);
+        const auto inlineBytes = checkedMul(elementType_->size(), inlineCapacity_);
+        alignment_ = std::max(std::alignment_of_v<SmallVectorData>,
+            SmallVectorData::bufferAlignment(elementType_.get(), options_));
+        size_ = align(checkedAdd(inlineOffset, inlineBytes), alignment_);
+        // The inline elements move along with the header
+        flags_ = elementType_->triviallyRelocatable() ? TriviallyRelocatable : NoFlags;
+    }
+
+    // Makes a single shared copy of elementType
+    template <typename ElementType, typename = EnableIfType<ElementType>>
+    SmallVector(const ElementType& elementType, size_t inlineCapacity, VectorOptions options = {})
+        : SmallVector(std::make_shared<ElementType>(elementType), inlineCapacity, options)
+    {
+    }
+
+    const TypePtr& elementType() const { return elementType_; }
+    size_t inlineCapacity() const { return inlineCapacity_; }
+    const VectorOptions& options() const { return options_; }
+
+    size_t hash() const override
+    {
+        auto seed = typeid(SmallVector).hash_code();
+        seed = hashCombine(seed, std::hash<const Type*> {}(elementType_.get()));
+        seed = hashCombine(seed, inlineCapacity_);
+        return hashCombine(seed, options_.hash());
+    }
+
+    bool equals(const Type& other) const override
+    {
+        const auto vec = dynamic_cast<const SmallVector*>(&other);
+        return vec && vec->elementType_ == elementType_ && vec->inlineCapacity_ == inlineCapacity_
+            && vec->options_ == options_;
+    }
+
+    TypePtr internChildren(TypeRegistry& registry) const override
+    {
+        auto interned = registry.intern(elementType_);
+        if (interned == elementType_) {
+            return nullptr;
+        }
+        return std::make_shared<SmallVector>(std::move(interned), inlineCapacity_, options_);
+    }
+
+    SmallVectorData& view(void* ptr) const { return *reinterpret_cast<SmallVectorData*>(ptr); }
+
+    void constructN(void* ptr, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            new (offset(ptr, i * stride))
+                SmallVectorData { elementType_.get(), inlineCapacity_, &options_ };
+        }
+    }
+
+    void destructN(void* ptr, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            at(ptr, i * stride).~SmallVectorData();
+        }
+    }
+
+    void copyN(void* dest, const void* src, size_t count, size_t stride) const override
+    {
+        constructN(dest, count, stride);
+        for (size_t i = 0; i < count; ++i) {
+            at(dest, i * stride)
+                = *reinterpret_cast<const SmallVectorData*>(offset(src, i * stride));
+        }
+    }
+
+    void moveN(void* dest, void* src, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            new (offset(dest, i * stride)) SmallVectorData(std::move(at(src, i * stride)));
+        }
+    }
+
+    void relocateN(void* dest, void* src, size_t count, size_t stride) const override
+    {
+        if (triviallyRelocatable()) {
+            copyStrided(dest, src, count, size_, stride);
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            auto& s = at(src, i * stride);
+            new (offset(dest, i * stride)) SmallVectorData(std::move(s));
+            s.~SmallVectorData();
+        }
+    }
+
+private:
+    static SmallVectorData& at(void* ptr, size_t off)
+    {
+        return *reinterpret_cast<SmallVectorData*>(offset(ptr, off));
+    }
+
+    TypePtr elementType_;
+    size_t inlineCapacity_;
+    VectorOptions options_;
+};
+
+// Like VectorData, but the elements are stored in chunks of a fixed number of elements, which
+// are never moved, so pointers to elements stay valid until the element is removed. Only the
+// table of chunk pointers is reallocated on growth. Indexing is a shift, a mask and one
+// indirection. Nothing points into the vector itself, so it may be relocated with a memcpy.
+class ChunkedVectorData {
+public:
+    // elementsPerChunk has to be a power of two
+    ChunkedVectorData(const Type* elementType, size_t elementsPerChunk,
+        const VectorOptions* options = &defaultVectorOptions())
+        : elementType_(elementType)
+        , options_(options)
+        , chunkShift_(log2(elementsPerChunk))
+    {
+    }
+
+    // Steals the chunks. The moved-from vector is left empty, but keeps its element type.
+    ChunkedVectorData(ChunkedVectorData&& other) noexcept
+        : elementType_(other.elementType_)
+        , options_(other.options_)
+        , chunks_(std::exchange(other.chunks_, nullptr))
+        , chunkCount_(std::exchange(other.chunkCount_, 0))
+        , chunkTableCapacity_(std::exchange(other.chunkTableCapacity_, 0))
+        , size_(std::exchange(other.size_, 0))
+        , chunkShift_(other.chunkShift_)
+    {
+    }
+
+    ~ChunkedVectorData()
+    {
+        resize(0);
+        for (size_t i = 0; i < chunkCount_; ++i) {
+            deallocateChunk(chunks_[i]);
+        }
+        deallocateChunkTable();
+    }
+
+    // Reuses the chunks that are already allocated
+    ChunkedVectorData& operator=(const ChunkedVectorData& other)
+    {
+        if (this == &other) {
+            return *this;
+        }
+        assert(chunkShift_ == other.chunkShift_);
+        resize(0);
+        reserve(other.size_);
+        const auto elementSize = elementType_->size();
+        forEachRun(0, other.size_, [&](size_t chunk, size_t first, size_t count) {
+            const auto off = first * elementSize;
+            elementType_->copyN(chunks_[chunk] + off, other.chunks_[chunk] + off, count,
+                elementSize);
+        });
+        size_ = other.size_;
+        return *this;
+    }
+
+    void* indexPtr(size_t idx)
+    {
+        return chunks_[idx >> chunkShift_] + (idx & chunkMask()) * elementType_->size();
+    }
+
+    const void* indexPtr(size_t idx) const
+    {
+        return chunks_[idx >> chunkShift_] + (idx & chunkMask()) * elementType_->size();
+    }
+
+    template <typename T>
+    T& index(size_t idx)
+    {
+        assert(sizeof(T) == elementType_->size());
+        assert(idx < size_);
+        return *reinterpret_cast<T*>(indexPtr(idx));
+    }
+
+    void grow(size_t num = 1) { resize(size_ + num); }
+
+    void resize(size_t newSize)
+    {
+        const auto elementSize = elementType_->size();
+        if (newSize > size_) {
+            reserve(newSize);
+            forEachRun(size_, newSize, [&](size_t chunk, size_t first, size_t count) {
+                elementType_->constructN(
+                    chunks_[chunk] + first * elementSize, count, elementSize);
+            });
+        } else if (newSize < size_) {
+            forEachRun(newSize, size_, [&](size_t chunk, size_t first, size_t count) {
+                elementType_->destructN(chunks_[chunk] + first * elementSize, count, elementSize);
+            });
+        }
+        size_ = newSize;
+    }
+
+    void clear() { resize(0); }
+
+    // Allocates chunks until there is room for capacity elements
+    void reserve(size_t capacity)
+    {
+        const auto chunkCount = (capacity + chunkMask()) >> chunkShift_;
+        if (chunkCount <= chunkCount_) {
+            return;
+        }
+        if (chunkCount > chunkTableCapacity_) {
+            reallocateChunkTable(std::max(chunkTableCapacity_ * 2, chunkCount));
+        }
+        const auto bytes = checkedMul(elementsPerChunk(), elementType_->size());
+        while (chunkCount_ < chunkCount) {
+            chunks_[chunkCount_] = static_cast<std::byte*>(
+                options_->resource->allocate(bytes, bufferAlignment()));
+            chunkCount_++;
+        }
+    }
+
+    // Frees the chunks that hold no elements
+    void shrinkToFit()
+    {
+        const auto chunkCount = (size_ + chunkMask()) >> chunkShift_;
+        while (chunkCount_ > chunkCount) {
+            chunkCount_--;
+            deallocateChunk(chunks_[chunkCount_]);
+        }
+    }
+
+    // Default-constructs a new element at the end and returns a pointer to it
+    void* emplaceBack()
+    {
+        reserve(size_ + 1);
+        const auto ptr = indexPtr(size_);
+        elementType_->construct(ptr);
+        size_++;
+        return ptr;
+    }
+
+    // Copy-constructs a new element at the end from src
+    void* pushBack(const void* src)
+    {
+        reserve(size_ + 1);
+        const auto ptr = indexPtr(size_);
+        elementType_->copyData(ptr, src);
+        size_++;
+        return ptr;
+    }
+
+    void popBack()
+    {
+        assert(size_ > 0);
+        elementType_->destruct(indexPtr(size_ - 1));
+        size_--;
+    }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    size_t capacity() const { return chunkCount_ << chunkShift_; }
+
+    size_t elementsPerChunk() const { return size_t(1) << chunkShift_; }
+
+    size_t chunkCount() const { return chunkCount_; }
+
+    // The elements of a chunk are contiguous. Only the last used chunk may be partially filled.
+    template <typename T = void>
+    T* chunk(size_t idx)
+    {
+        assert(idx < chunkCount_);
+        return reinterpret_cast<T*>(chunks_[idx]);
+    }
+
+    // The number of elements in chunk idx
+    size_t chunkSize(size_t idx) const
+    {
+        const auto first = idx << chunkShift_;
+        return first < size_ ? std::min(elementsPerChunk(), size_ - first) : 0;
+    }
+
+    const Type* elementType() const { return elementType_; }
+
+private:
+    static size_t log2(size_t value)
+    {
+        assert(isPowerOfTwo(value));
+        size_t shift = 0;
+        while ((size_t(1) << shift) < value) {
+            shift++;
+        }
+        return shift;
+    }
+
+    size_t chunkMask() const { return elementsPerChunk() - 1; }
+
+    size_t bufferAlignment() const
+    {
+        return std::max(elementType_->alignment(), options_->alignment);
+    }
+
+    // Calls func(chunk, firstIndexInChunk, count) for every chunk that overlaps [begin, end)
+    template <typename Func>
+    void forEachRun(size_t begin, size_t end, Func&& func) const
+    {
+        while (begin < end) {
+            const auto chunk = begin >> chunkShift_;
+            const auto first = begin & chunkMask();
+            const auto count = std::min(elementsPerChunk() - first, end - begin);
+            func(chunk, first, count);
+            begin += count;
+        }
+    }
+
+    void reallocateChunkTable(size_t newCapacity)
+    {
+        const auto bytes = checkedMul(newCapacity, sizeof(std::byte*));
+        const auto newChunks = static_cast<std::byte**>(
+            options_->resource->allocate(bytes, alignof(std::byte*)));
+        if (chunkCount_ > 0) {
+            std::memcpy(newChunks, chunks_, chunkCount_ * sizeof(std::byte*));
+        }
+        deallocateChunkTable();
+        chunks_ = newChunks;
+        chunkTableCapacity_ = newCapacity;
+    }
+
+    void deallocateChunkTable()
+    {
+        if (chunks_) {
+            const auto bytes = chunkTableCapacity_ * sizeof(std::byte*);
+            options_->resource->deallocate(chunks_, bytes, alignof(std::byte*));
+        }
+    }
+
+    void deallocateChunk(std::byte* chunk)
+    {
+        const auto bytes = elementsPerChunk() * elementType_->size();
+        options_->resource->deallocate(chunk, bytes, bufferAlignment());
+    }
+
+    const Type* elementType_;
+    const VectorOptions* options_;
+    std::byte** chunks_ = nullptr;
+    size_t chunkCount_ = 0;
+    size_t chunkTableCapacity_ = 0;
+    size_t size_ = 0;
+    size_t chunkShift_;
+};
+
+class ChunkedVector : public Type {
+public:
+    // If elementsPerChunk is 0, chunks are about 16 KiB. Otherwise it has to be a power of two.
+    // The growth policy of options does not apply, because chunks always have the same size.
+    ChunkedVector(TypePtr elementType, size_t elementsPerChunk = 0, VectorOptions options = {})
+        : Type(sizeof(ChunkedVectorData), std::alignment_of_v<ChunkedVectorData>,
+            TriviallyRelocatable)
+        , elementType_(std::move(elementType))
+        , elementsPerChunk_(elementsPerChunk)
+        , options_(options)
+    {
+        assert(isPowerOfTwo(options_.alignment));
+        if (elementsPerChunk_ == 0) {
+            constexpr size_t chunkBytes = 16 * 1024;
+            const auto elementSize = std::max(elementType_->size(), size_t(1));
+            elementsPerChunk_ = floorPowerOfTwo(chunkBytes / elementSize);
+        }
+        assert(isPowerOfTwo(elementsPerChunk_));
+    }
+
+    // Makes a single shared copy of elementType
+    template <typename ElementType, typename = EnableIfType<ElementType>>
+    ChunkedVector(
+        const ElementType& elementType, size_t elementsPerChunk = 0, VectorOptions options = {})
+        : ChunkedVector(std::make_shared<ElementType>(elementType), elementsPerChunk, options)
+    {
+    }
+
+    const TypePtr& elementType() const { return elementType_; }
+    size_t elementsPerChunk() const { return elementsPerChunk_; }
+    const VectorOptions& options() const { return options_; }
+
+    size_t hash() const override
+    {
+        auto seed = typeid(ChunkedVector).hash_code();
+        seed = hashCombine(seed, std::hash<const Type*> {}(elementType_.get()));
+        seed = hashCombine(seed, elementsPerChunk_);
+        return hashCombine(seed, options_.hash());
+    }
+
+    bool equals(const Type& other) const override
+    {
+        const auto vec = dynamic_cast<const ChunkedVector*>(&other);
+        return vec && vec->elementType_ == elementType_
+            && vec->elementsPerChunk_ == elementsPerChunk_ && vec->options_ == options_;
+    }
+
+    TypePtr internChildren(TypeRegistry& registry) const override
+    {
+        auto interned = registry.intern(elementType_);
+        if (interned == elementType_) {
+            return nullptr;
+        }
+        return std::make_shared<ChunkedVector>(std::move(interned), elementsPerChunk_, options_);
+    }
+
+    ChunkedVectorData& view(void* ptr) const
+    {
+        return *reinterpret_cast<ChunkedVectorData*>(ptr);
+    }
+
+    void constructN(void* ptr, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            new (offset(ptr, i * stride))
+                ChunkedVectorData { elementType_.get(), elementsPerChunk_, &options_ };
+        }
+    }
+
+    void destructN(void* ptr, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            at(ptr, i * stride).~ChunkedVectorData();
+        }
+    }
+
+    void copyN(void* dest, const void* src, size_t count, size_t stride) const override
+    {
+        constructN(dest, count, stride);
+        for (size_t i = 0; i < count; ++i) {
+            at(dest, i * stride)
+                = *reinterpret_cast<const ChunkedVectorData*>(offset(src, i * stride));
+        }
+    }
+
+    void moveN(void* dest, void* src, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            new (offset(dest, i * stride)) ChunkedVectorData(std::move(at(src, i * stride)));
+        }
+    }
+
+    void relocateN(void* dest, void* src, size_t count, size_t stride) const override
+    {
+        copyStrided(dest, src, count, sizeof(ChunkedVectorData), stride);
+    }
+
+private:
+    static ChunkedVectorData& at(void* ptr, size_t off)
+    {
+        return *reinterpret_cast<ChunkedVectorData*>(offset(ptr, off));
+    }
+
+    TypePtr elementType_;
+    size_t elementsPerChunk_;
+    VectorOptions options_;
+};
+
+// Like VectorData, but for a Struct element type and stored as a struct of arrays: every field
+// is a contiguous column. The columns share a single allocation, which starts with a table
+// of column pointers, so an empty instance does not allocate and indexing does no math.
+class SoAVectorData {
+public:
+    SoAVectorData(const Struct* elementType, const VectorOptions* options = &defaultVectorOptions())
+        : elementType_(elementType)
+        , options_(options)
+    {
+    }
+
+    // The moved-from vector is left empty
+    SoAVectorData(SoAVectorData&& other) noexcept
+        : elementType_(other.elementType_)
+        , options_(other.options_)
+        , data_(other.data_)
+        , size_(other.size_)
+        , capacity_(other.capacity_)
+    {
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.capacity_ = 0;
+    }
+
+    ~SoAVectorData()
+    {
+        resize(0);
+        deallocate(data_, capacity_);
+    }
+
+    SoAVectorData& operator=(const SoAVectorData& other)
+    {
+        if (this == &other) {
+            return *this;
+        }
+        resize(0);
+        if (capacity_ < other.size_) {
+            reallocate(other.size_);
+        }
+        if (other.size_ > 0) {
+            for (size_t f = 0; f < elementType_->fieldCount(); ++f) {
+                const auto& type = *elementType_->field(f).type;
+                type.copyN(columnPtr(f), other.columnPtr(f), other.size_, type.size());
+            }
+        }
+        size_ = other.size_;
+        return *this;
+    }
+
+    // Mirrors Struct::View for a single row
+    class RowView {
+    public:
+        RowView(SoAVectorData* vec, size_t row)
+            : vec_(vec)
+            , row_(row)
+        {
+        }
+
+        void* fieldPtr(size_t index)
+        {
+            return vec_->columnPtr(index) + row_ * vec_->elementType_->field(index).type->size();
+        }
+
+        void* fieldPtr(std::string_view name)
+        {
+            return fieldPtr(vec_->elementType_->getFieldIndex(name).value());
+        }
+
+        template <typename T>
+        T& field(size_t index)
+        {
+            return *reinterpret_cast<T*>(fieldPtr(index));
+        }
+
+        template <typename T>
+        T& field(std::string_view name)
+        {
+            return field<T>(vec_->elementType_->getFieldIndex(name).value());
+        }
+
+    private:
+        SoAVectorData* vec_;
+        size_t row_;
+    };
+
+    RowView row(size_t idx)
+    {
+        assert(idx < size_);
+        return RowView(this, idx);
+    }
+
+    // The column of a field has size() contiguous elements
+    std::byte* columnPtr(size_t fieldIndex) { return data_ ? columns()[fieldIndex] : nullptr; }
+
+    const std::byte* columnPtr(size_t fieldIndex) const
+    {
+        return data_ ? columns()[fieldIndex] : nullptr;
+    }
+
+    template <typename T>
+    T* column(size_t fieldIndex)
+    {
+        assert(sizeof(T) == elementType_->field(fieldIndex).type->size());
+        return reinterpret_cast<T*>(columnPtr(fieldIndex));
+    }
+
+    void grow(size_t num = 1) { resize(size_ + num); }
+
+    void resize(size_t newSize)
+    {
+        if (newSize > size_ && capacity_ < newSize) {
+            reallocate(options_->growth.grow(capacity_, newSize, elementType_->size()));
+        }
+        for (size_t f = 0; f < elementType_->fieldCount(); ++f) {
+            const auto& type = *elementType_->field(f).type;
+            if (newSize > size_) {
+                type.constructN(columnPtr(f) + size_ * type.size(), newSize - size_, type.size());
+            } else if (newSize < size_) {
+                type.destructN(columnPtr(f) + newSize * type.size(), size_ - newSize, type.size());
+            }
+        }
+        size_ = newSize;
+    }
+
+    size_t size() const { return size_; }
+
+    size_t capacity() const { return capacity_; }
+
+    const Struct* elementType() const { return elementType_; }
+
+private:
+    std::byte** columns() const { return reinterpret_cast<std::byte**>(data_); }
+
+    size_t columnAlignment(size_t fieldIndex) const
+    {
+        const auto& type = *elementType_->field(fieldIndex).type;
+        return std::max(type.alignment(), options_->alignment);
+    }
+
+    size_t bufferAlignment() const
+    {
+        auto alignment = std::max(alignof(std::byte*), options_->alignment);
+        for (size_t f = 0; f < elementType_->fieldCount(); ++f) {
+            alignment = std::max(alignment, columnAlignment(f));
+        }
+        return alignment;
+    }
+
+    // Returns the size of the allocation and fills the column table, if data is not null
+    size_t layout(std::byte* data, size_t capacity) const
+    {
+        const auto fieldCount = elementType_->fieldCount();
+        auto offset = checkedMul(fieldCount, sizeof(std::byte*));
+        for (size_t f = 0; f < fieldCount; ++f) {
+            offset = align(offset, columnAlignment(f));
+            if (data) {
+                reinterpret_cast<std::byte**>(data)[f] = data + offset;
+            }
+            offset = checkedAdd(offset, checkedMul(elementType_->field(f).type->size(), capacity));
+        }
+        return std::max(offset, size_t(1));
+    }
+
+    void reallocate(size_t newCapacity)
+    {
+        const auto newData = static_cast<std::byte*>(
+            options_->resource->allocate(layout(nullptr, newCapacity), bufferAlignment()));
+        layout(newData, newCapacity);
+        if (size_ > 0) {
+            for (size_t f = 0; f < elementType_->fieldCount(); ++f) {
+                elementType_->field(f).type->relocate(
+                    reinterpret_cast<std::byte**>(newData)[f], columnPtr(f), size_);
+            }
+        }
+        deallocate(data_, capacity_);
+        data_ = newData;
+        capacity_ = newCapacity;
+    }
+
+    void deallocate(std::byte* data, size_t capacity)
+    {
+        if (data) {
+            options_->resource->deallocate(data, layout(nullptr, capacity), bufferAlignment());
+        }
+    }
+
+    const Struct* elementType_;
+    const VectorOptions* options_;
+    std::byte* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
+
+// A vector of structs that is stored as a struct of arrays (see SoAVectorData)
+class SoAVector : public Type {
+public:
+    SoAVector(std::shared_ptr<const Struct> elementType, VectorOptions options = {})
+        : Type(sizeof(SoAVectorData), std::alignment_of_v<SoAVectorData>, TriviallyRelocatable)
+        , elementType_(std::move(elementType))
+        , options_(options)
+    {
+        assert(isPowerOfTwo(options_.alignment));
+    }
+
+    // Makes a single shared copy of elementType
+    SoAVector(const Struct& elementType, VectorOptions options = {})
+        : SoAVector(std::make_shared<Struct>(elementType), options)
+    {
+    }
+
+    SoAVectorData& view(void* ptr) const { return *reinterpret_cast<SoAVectorData*>(ptr); }
+
+    const std::shared_ptr<const Struct>& elementType() const { return elementType_; }
+    const VectorOptions& options() const { return options_; }
+
+    size_t hash() const override
+    {
+        auto seed = typeid(SoAVector).hash_code();
+        seed = hashCombine(seed, std::hash<const Type*> {}(elementType_.get()));
+        return hashCombine(seed, options_.hash());
+    }
+
+    bool equals(const Type& other) const override
+    {
+        const auto vec = dynamic_cast<const SoAVector*>(&other);
+        return vec && vec->elementType_ == elementType_ && vec->options_ == options_;
+    }
+
+    TypePtr internChildren(TypeRegistry& registry) const override
+    {
+        auto interned = registry.intern(elementType_);
+        if (interned == elementType_) {
+            return nullptr;
+        }
+        return std::make_shared<SoAVector>(
+            std::static_pointer_cast<const Struct>(std::move(interned)), options_);
+    }
+
+    void constructN(void* ptr, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            new (offset(ptr, i * stride)) SoAVectorData { elementType_.get(), &options_ };
+        }
+    }
+
+    void destructN(void* ptr, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            at(ptr, i * stride).~SoAVectorData();
+        }
+    }
+
+    void copyN(void* dest, const void* src, size_t count, size_t stride) const override
+    {
+        constructN(dest, count, stride);
+        for (size_t i = 0; i < count; ++i) {
+            at(dest, i * stride) = *reinterpret_cast<const SoAVectorData*>(offset(src, i * stride));
+        }
+    }
+
+    void moveN(void* dest, void* src, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            new (offset(dest, i * stride)) SoAVectorData(std::move(at(src, i * stride)));
+        }
+    }
+
+    void relocateN(void* dest, void* src, size_t count, size_t stride) const override
+    {
+        copyStrided(dest, src, count, sizeof(SoAVectorData), stride);
+    }
+
+private:
+    static SoAVectorData& at(void* ptr, size_t off)
+    {
+        return *reinterpret_cast<SoAVectorData*>(offset(ptr, off));
+    }
+
+    std::shared_ptr<const Struct> elementType_;
+    VectorOptions options_;
+};
+
+// The layout of a block of a TiledVectorData. Every field is stored as a contiguous array of
+// blockSize lanes inside the block.
+struct TiledLayout {
+    size_t blockSize;
+    size_t blockStride; // size of a block including padding
+    size_t alignment; // of every block
+    std::vector<size_t> laneOffsets; // per field, relative to the start of the block
+};
+
+// Like SoAVectorData, but the columns are split into blocks of blockSize rows (AoSoA), so that
+// all fields of a row are close to each other, but every field of a block can still be loaded
+// into a SIMD register directly.
+class TiledVectorData {
+public:
+    TiledVectorData(const Struct* elementType, const TiledLayout* layout,
+        const VectorOptions* options = &defaultVectorOptions())
+        : elementType_(elementType)
+        , layout_(layout)
+        , options_(options)
+    {
+    }
+
+    // The moved-from vector is left empty
+    TiledVectorData(TiledVectorData&& other) noexcept
+        : elementType_(other.elementType_)
+        , layout_(other.layout_)
+        , options_(other.options_)
+        , data_(other.data_)
+        , size_(other.size_)
+        , blockCapacity_(other.blockCapacity_)
+    {
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.blockCapacity_ = 0;
+    }
+
+    ~TiledVectorData()
+    {
+        resize(0);
+        deallocate();
+    }
+
+    TiledVectorData& operator=(const TiledVectorData& other)
+    {
+        if (this == &other) {
+            return *this;
+        }
+        resize(0);
+        reserveBlocks(blockCount(other.size_));
+        forEachRun(0, other.size_, [&](size_t block, size_t lane, size_t count) {
+            for (size_t f = 0; f < elementType_->fieldCount(); ++f) {
+                const auto& type = *elementType_->field(f).type;
+                type.copyN(lanePtr(block, f, lane), other.lanePtr(block, f, lane), count,
+                    type.size());
+            }
+        });
+        size_ = other.size_;
+        return *this;
+    }
+
+    class BlockView {
+    public:
+        BlockView(TiledVectorData* vec, size_t block)
+            : vec_(vec)
+            , block_(block)
+        {
+        }
+
+        // Pointer to the blockSize contiguous lanes of a field
+        void* lanePtr(size_t fieldIndex) { return vec_->lanePtr(block_, fieldIndex, 0); }
+
+        template <typename T>
+        T* lanes(size_t fieldIndex)
+        {
+            assert(sizeof(T) == vec_->elementType_->field(fieldIndex).type->size());
+            return reinterpret_cast<T*>(lanePtr(fieldIndex));
+        }
+
+        // Number of used lanes, which is only less than blockSize for the last block
+        size_t size() const
+        {
+            const auto blockSize = vec_->layout_->blockSize;
+            return std::min(blockSize, vec_->size_ - block_ * blockSize);
+        }
+
+    private:
+        TiledVectorData* vec_;
+        size_t block_;
+    };
+
+    // Mirrors Struct::View for a single row
+    class RowView {
+    public:
+        RowView(TiledVectorData* vec, size_t row)
+            : vec_(vec)
+            , row_(row)
+        {
+        }
+
+        void* fieldPtr(size_t index)
+        {
+            const auto blockSize = vec_->layout_->blockSize;
+            return vec_->lanePtr(row_ / blockSize, index, row_ % blockSize);
+        }
+
+        void* fieldPtr(std::string_view name)
+        {
+            return fieldPtr(vec_->elementType_->getFieldIndex(name).value());
+        }
+
+        template <typename T>
+        T& field(size_t index)
+        {
+            return *reinterpret_cast<T*>(fieldPtr(index));
+        }
+
+        template <typename T>
+        T& field(std::string_view name)
+        {
+            return field<T>(vec_->elementType_->getFieldIndex(name).value());
+        }
+
+    private:
+        TiledVectorData* vec_;
+        size_t row_;
+    };
+
+    RowView row(size_t idx)
+    {
+        assert(idx < size_);
+        return RowView(this, idx);
+    }
+
+    BlockView block(size_t idx)
+    {
+        assert(idx < blockCount());
+        return BlockView(this, idx);
+    }
+
+    size_t blockCount() const { return blockCount(size_); }
+    size_t blockSize() const { return layout_->blockSize; }
+
+    void grow(size_t num = 1) { resize(size_ + num); }
+
+    void resize(size_t newSize)
+    {
+        if (newSize > size_) {
+            const auto blocks = blockCount(newSize);
+            if (blockCapacity_ < blocks) {
+                reserveBlocks(options_->growth.grow(blockCapacity_, blocks, layout_->blockStride));
+            }
+        }
+        const auto begin = std::min(size_, newSize);
+        const auto end = std::max(size_, newSize);
+        forEachRun(begin, end, [&](size_t block, size_t lane, size_t count) {
+            for (size_t f = 0; f < elementType_->fieldCount(); ++f) {
+                const auto& type = *elementType_->field(f).type;
+                if (newSize > size_) {
+                    type.constructN(lanePtr(block, f, lane), count, type.size());
+                } else {
+                    type.destructN(lanePtr(block, f, lane), count, type.size());
+                }
+            }
+        });
+        size_ = newSize;
+    }
+
+    size_t size() const { return size_; }
+
+    size_t capacity() const { return blockCapacity_ * layout_->blockSize; }
+
+    const Struct* elementType() const { return elementType_; }
+
+private:
+    size_t blockCount(size_t rows) const
+    {
+        return (rows + layout_->blockSize - 1) / layout_->blockSize;
+    }
+
+    std::byte* lanePtr(size_t block, size_t fieldIndex, size_t lane) const
+    {
+        return data_ + block * layout_->blockStride + layout_->laneOffsets[fieldIndex]
+            + lane * elementType_->field(fieldIndex).type->size();
+    }
+
+    // Calls func(block, firstLane, count) for every block that overlaps the rows [begin, end)
+    template <typename Func>
+    void forEachRun(size_t begin, size_t end, Func&& func) const
+    {
+        const auto blockSize = layout_->blockSize;
+        while (begin < end) {
+            const auto block = begin / blockSize;
+            const auto lane = begin % blockSize;
+            const auto count = std::min(blockSize - lane, end - begin);
+            func(block, lane, count);
+            begin += count;
+        }
+    }
+
+    size_t bufferAlignment() const { return std::max(layout_->alignment, options_->alignment); }
+
+    void reserveBlocks(size_t blocks)
+    {
+        if (blocks <= blockCapacity_) {
+            return;
+        }
+        const auto bytes = checkedMul(blocks, layout_->blockStride);
+        const auto newData
+            = static_cast<std::byte*>(options_->resource->allocate(bytes, bufferAlignment()));
+        if (elementType_->triviallyRelocatable()) {
+            if (size_ > 0) {
+                std::memcpy(newData, data_, blockCount() * layout_->blockStride);
+            }
+        } else {
+            forEachRun(0, size_, [&](size_t block, size_t lane, size_t count) {
+                for (size_t f = 0; f < elementType_->fieldCount(); ++f) {
+                    const auto off = lanePtr(block, f, lane) - data_;
+                    elementType_->field(f).type->relocate(newData + off, data_ + off, count);
+                }
+            });
+        }
+        deallocate();
+        data_ = newData;
+        blockCapacity_ = blocks;
+    }
+
+    void deallocate()
+    {
+        if (data_) {
+            const auto bytes = blockCapacity_ * layout_->blockStride;
+            options_->resource->deallocate(data_, bytes, bufferAlignment());
+        }
+    }
+
+    const Struct* elementType_;
+    const TiledLayout* layout_;
+    const VectorOptions* options_;
+    std::byte* data_ = nullptr;
+    size_t size_ = 0;
+    size_t blockCapacity_ = 0;
+};
+
+// A vector of structs stored in blocks of blockSize rows (see TiledVectorData)
+class TiledVector : public Type {
+public:
+    // The SIMD register size the automatic block size is chosen for (AVX2)
+    static constexpr size_t defaultSimdBytes = 32;
+
+    // A blockSize of 0 chooses one with chooseBlockSize for defaultSimdBytes
+    TiledVector(std::shared_ptr<const Struct> elementType, size_t blockSize = 0,
+        VectorOptions options = {})
+        : Type(sizeof(TiledVectorData), std::alignment_of_v<TiledVectorData>, TriviallyRelocatable)
+        , elementType_(std::move(elementType))
+        , options_(options)
+    {
+        assert(isPowerOfTwo(options_.alignment));
+        layout_.blockSize
+            = blockSize > 0 ? blockSize : chooseBlockSize(*elementType_, defaultSimdBytes);
+        size_t offset = 0;
+        layout_.alignment = 1;
+        for (size_t f = 0; f < elementType_->fieldCount(); ++f) {
+            const auto& type = *elementType_->field(f).type;
+            const auto laneBytes = checkedMul(type.size(), layout_.blockSize);
+            // Align the lanes of every field for aligned SIMD loads, if they span a register.
+            // options.alignment applies to every lane, e.g. 64 for AVX-512 loads.
+            const auto laneAlignment = std::max({ type.alignment(), options_.alignment,
+                std::min(defaultSimdBytes, floorPowerOfTwo(laneBytes)) });
+            offset = align(offset, laneAlignment);
+            layout_.laneOffsets.push_back(offset);
+            offset = checkedAdd(offset, laneBytes);
+            layout_.alignment = std::max(layout_.alignment, laneAlignment);
+        }
+        layout_.blockStride = std::max(align(offset, layout_.alignment), size_t(1));
+    }
+
+    // Makes a single shared copy of elementType
+    TiledVector(const Struct& elementType, size_t blockSize = 0, VectorOptions options = {})
+        : TiledVector(std::make_shared<Struct>(elementType), blockSize, options)
+    {
+    }
+
+    // The smallest power of two in [4, 16], such that the lanes of the smallest field fill a
+    // SIMD register of simdBytes
+    static size_t chooseBlockSize(const Struct& elementType, size_t simdBytes)
+    {
+        size_t minFieldSize = SIZE_MAX;
+        for (size_t f = 0; f < elementType.fieldCount(); ++f) {
+            const auto size = elementType.field(f).type->size();
+            if (size > 0) {
+                minFieldSize = std::min(minFieldSize, size);
+            }
+        }
+        size_t blockSize = 4;
+        while (blockSize < 16 && blockSize * minFieldSize < simdBytes) {
+            blockSize *= 2;
+        }
+        return blockSize;
+    }
+
+    TiledVectorData& view(void* ptr) const { return *reinterpret_cast<TiledVectorData*>(ptr); }
+
+    const std::shared_ptr<const Struct>& elementType() const { return elementType_; }
+    const TiledLayout& layout() const { return layout_; }
+    const VectorOptions& options() const { return options_; }
+
+    size_t hash() const override
+    {
+        auto seed = typeid(TiledVector).hash_code();
+        seed = hashCombine(seed, std::hash<const Type*> {}(elementType_.get()));
+        seed = hashCombine(seed, layout_.blockSize);
+        return hashCombine(seed, options_.hash());
+    }
+
+    bool equals(const Type& other) const override
+    {
+        const auto vec = dynamic_cast<const TiledVector*>(&other);
+        return vec && vec->elementType_ == elementType_
+            && vec->layout_.blockSize == layout_.blockSize && vec->options_ == options_;
+    }
+
+    TypePtr internChildren(TypeRegistry& registry) const override
+    {
+        auto interned = registry.intern(elementType_);
+        if (interned == elementType_) {
+            return nullptr;
+        }
+        return std::make_shared<TiledVector>(
+            std::static_pointer_cast<const Struct>(std::move(interned)), layout_.blockSize,
+            options_);
+    }
+
+    void constructN(void* ptr, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            new (offset(ptr, i * stride))
+                TiledVectorData { elementType_.get(), &layout_, &options_ };
+        }
+    }
+
+    void destructN(void* ptr, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            at(ptr, i * stride).~TiledVectorData();
+        }
+    }
+
+    void copyN(void* dest, const void* src, size_t count, size_t stride) const override
+    {
+        constructN(dest, count, stride);
+        for (size_t i = 0; i < count; ++i) {
+            const auto& other = *reinterpret_cast<const TiledVectorData*>(offset(src, i * stride));
+            at(dest, i * stride) = other;
+        }
+    }
+
+    void moveN(void* dest, void* src, size_t count, size_t stride) const override
+    {
+        for (size_t i = 0; i < count; ++i) {
+            new (offset(dest, i * stride)) TiledVectorData(std::move(at(src, i * stride)));
+        }
+    }
+
+    void relocateN(void* dest, void* src, size_t count, size_t stride) const override
+    {
+        copyStrided(dest, src, count, sizeof(TiledVectorData), stride);
+    }
+
+private:
+    static TiledVectorData& at(void* ptr, size_t off)
+    {
+        return *reinterpret_cast<TiledVectorData*>(offset(ptr, off));
+    }
+
+    std::shared_ptr<const Struct> elementType_;
+    TiledLayout layout_;
+    VectorOptions options_;
+};
+
+// A path like "start.x" or "points[2].x", resolved once against a type, so that accessing the
+// field it refers to is a pointer addition (plus one indirection per vector index on the path).
+class FieldPath {
+public:
+    // Returns std::nullopt if a field does not exist, a field that is not a struct is accessed
+    // with "." or a field that is not a (small) vector or fixed array is indexed. Fixed array
+    // indices are bounds checked, vector indices are only checked on access.
+    static std::optional<FieldPath> resolve(const Type& root, std::string_view path)
+    {
+        FieldPath fieldPath;
+        fieldPath.type_ = &root;
+        size_t pos = 0;
+        while (pos <= path.size()) {
+            const auto end = std::min(path.find_first_of(".[", pos), path.size());
+            const auto st = dynamic_cast<const Struct*>(fieldPath.type_);
+            if (!st) {
+                return std::nullopt;
+            }
+            const auto index = st->getFieldIndex(path.substr(pos, end - pos));
+            if (!index) {
+                return std::nullopt;
+            }
+            fieldPath.offset_ += st->field(*index).offset;
+            fieldPath.type_ = st->field(*index).type.get();
+            pos = end;
+
+            while (pos < path.size() && path[pos] == '[') {
+                const auto close = path.find(']', pos);
+                if (close == std::string_view::npos) {
+                    return std::nullopt;
+                }
+                const auto elementIndex = parseIndex(path.substr(pos + 1, close - pos - 1));
+                if (!elementIndex) {
+                    return std::nullopt;
+                }
+                if (const auto vec = dynamic_cast<const Vector*>(fieldPath.type_)) {
+                    fieldPath.addStep<VectorData>(*elementIndex, vec->elementType().get());
+                } else if (const auto vec = dynamic_cast<const SmallVector*>(fieldPath.type_)) {
+                    fieldPath.addStep<SmallVectorData>(*elementIndex, vec->elementType().get());
+                } else if (const auto vec = dynamic_cast<const ChunkedVector*>(fieldPath.type_)) {
+                    fieldPath.addStep<ChunkedVectorData>(*elementIndex, vec->elementType().get());
+                } else if (const auto arr = dynamic_cast<const FixedArray*>(fieldPath.type_)) {
+                    if (*elementIndex >= arr->count()) {
+                        return std::nullopt;
+                    }
+                    fieldPath.offset_ += *elementIndex * arr->elementType()->size();
+                    fieldPath.type_ = arr->elementType().get();
+                } else {
+                    return std::nullopt;
+                }
+                pos = close + 1;
+            }
+
+            if (pos == path.size()) {
+                return fieldPath;
+            }
+            if (path[pos] != '.') {
+                return std::nullopt;
+            }
+            pos++;
+        }
+        return std::nullopt;
+    }
+
+    void* fieldPtr(void* ptr) const
+    {
+        for (const auto& step : steps_) {
+            ptr = step.indexPtr(rttypes::offset(ptr, step.offset), step.index);
+        }
+        return rttypes::offset(ptr, offset_);
+    }
+
+    template <typename T>
+    T& field(void* ptr) const
+    {
+        assert(holds<T>());
+        return *reinterpret_cast<T*>(fieldPtr(ptr));
+    }
+
+    // True if the field is of the type whose instances are T
+    template <typename T>
+    bool holds() const
+    {
+        if constexpr (std::is_same_v<T, std::pmr::string>) {
+            return dynamic_cast<const PmrString*>(type_) != nullptr;
+        } else if constexpr (std::is_same_v<T, VectorData>) {
+            return dynamic_cast<const Vector*>(type_) != nullptr;
+        } else if constexpr (std::is_same_v<T, SmallVectorData>) {
+            return dynamic_cast<const SmallVector*>(type_) != nullptr;
+        } else if constexpr (std::is_same_v<T, ChunkedVectorData>) {
+            return dynamic_cast<const ChunkedVector*>(type_) != nullptr;
+        } else if constexpr (std::is_same_v<T, SoAVectorData>) {
+            return dynamic_cast<const SoAVector*>(type_) != nullptr;
+        } else if constexpr (std::is_same_v<T, TiledVectorData>) {
+            return dynamic_cast<const TiledVector*>(type_) != nullptr;
+        } else {
+            return dynamic_cast<const ConcreteType<T>*>(type_) != nullptr;
+        }
+    }
+
+    const Type* type() const { return type_; }
+
+    // If true, the field is always at offset() relative to the root object
+    bool isStatic() const { return steps_.empty(); }
+
+    // The offset of the field relative to the last vector element on the path (or the root)
+    size_t offset() const { return offset_; }
+
+private:
+    // Add offset, then index the vector (VectorData, SmallVectorData, ...) at that address
+    struct Step {
+        size_t offset;
+        size_t index;
+        void* (*indexPtr)(void* vec, size_t index);
+    };
+
+    template <typename VectorType>
+    static void* indexPtr(void* ptr, size_t index)
+    {
+        auto& vec = *reinterpret_cast<VectorType*>(ptr);
+        assert(index < vec.size());
+        return vec.indexPtr(index);
+    }
+
+    template <typename VectorType>
+    void addStep(size_t index, const Type* elementType)
+    {
+        steps_.push_back(Step { offset_, index, &indexPtr<VectorType> });
+        offset_ = 0;
+        type_ = elementType;
+    }
+
+    static std::optional<size_t> parseIndex(std::string_view str)
+    {
+        if (str.empty()) {
+            return std::nullopt;
+        }
+        size_t index = 0;
+        for (const auto ch : str) {
+            if (ch < '0' || ch > '9') {
+                return std::nullopt;
+            }
+            const auto digit = static_cast<size_t>(ch - '0');
+            if (index > (SIZE_MAX - digit) / 10) {
+                return std::nullopt;
+            }
+            index = index * 10 + digit;
+        }
+        return index;
+    }
+
+    std::vector<Step> steps_;
+    size_t offset_ = 0;
+    const Type* type_ = nullptr;
+};
+
+// One field of every element of a vector of structs (or any strided array of T). Accessing an
+// element is a multiplication and an addition, without a virtual call or name lookup. The span
+// is invalidated when the vector reallocates.
+template <typename T>
+class StridedSpan {
+    using Byte = std::conditional_t<std::is_const_v<T>, const std::byte, std::byte>;
+
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = std::remove_cv_t<T>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T*;
+        using reference = T&;
+
+        Iterator() = default;
+
+        Iterator(Byte* ptr, size_t stride)
+            : ptr_(ptr)
+            , stride_(static_cast<difference_type>(stride))
+        {
+        }
+
+        T& operator*() const { return *reinterpret_cast<T*>(ptr_); }
+        T* operator->() const { return reinterpret_cast<T*>(ptr_); }
+        T& operator[](difference_type n) const { return *(*this + n); }
+
+        Iterator& operator++() { return *this += 1; }
+        Iterator& operator--() { return *this -= 1; }
+        Iterator operator++(int) { return std::exchange(*this, *this + 1); }
+        Iterator operator--(int) { return std::exchange(*this, *this - 1); }
+
+        Iterator& operator+=(difference_type n)
+        {
+            ptr_ += n * stride_;
+            return *this;
+        }
+
+        Iterator& operator-=(difference_type n) { return *this += -n; }
+
+        friend Iterator operator+(Iterator it, difference_type n) { return it += n; }
+        friend Iterator operator+(difference_type n, Iterator it) { return it += n; }
+        friend Iterator operator-(Iterator it, difference_type n) { return it -= n; }
+
+        friend difference_type operator-(const Iterator& a, const Iterator& b)
+        {
+            assert(a.stride_ == b.stride_);
+            return (a.ptr_ - b.ptr_) / a.stride_;
+        }
+
+        friend bool operator==(const Iterator& a, const Iterator& b) { return a.ptr_ == b.ptr_; }
+        friend bool operator!=(const Iterator& a, const Iterator& b) { return a.ptr_ != b.ptr_; }
+        friend bool operator<(const Iterator& a, const Iterator& b) { return a.ptr_ < b.ptr_; }
+        friend bool operator>(const Iterator& a, const Iterator& b) { return a.ptr_ > b.ptr_; }
+        friend bool operator<=(const Iterator& a, const Iterator& b) { return a.ptr_ <= b.ptr_; }
+        friend bool operator>=(const Iterator& a, const Iterator& b) { return a.ptr_ >= b.ptr_; }
+
+    private:
+        Byte* ptr_ = nullptr;
+        difference_type stride_ = 0;
+    };
+
+    StridedSpan() = default;
+
+    // stride is in bytes
+    StridedSpan(T* data, size_t size, size_t stride)
+        : data_(reinterpret_cast<Byte*>(data))
+        , size_(size)
+        , stride_(stride)
+    {
+        assert(stride >= sizeof(T) && stride % alignof(T) == 0);
+    }
+
+    // The span of field fieldIndex of every element of vec, which must be a vector of structs
+    template <typename Vec>
+    static StridedSpan field(Vec& vec, size_t fieldIndex)
+    {
+        const auto st = dynamic_cast<const Struct*>(vec.elementType());
+        assert(st);
+        const auto& field = st->field(fieldIndex);
+        assert(field.type->size() == sizeof(T));
+        // An empty vector might not have a buffer to add the offset to
+        if (vec.size() == 0) {
+            return StridedSpan(nullptr, 0, st->size());
+        }
+        const auto data = vec.template data<Byte>() + field.offset;
+        return StridedSpan(reinterpret_cast<T*>(data), vec.size(), st->size());
+    }
+
+    // path has to be resolved against the element type of vec and must be static, i.e. it can
+    // not index a vector.
+    template <typename Vec>
+    static StridedSpan field(Vec& vec, const FieldPath& path)
+    {
+        assert(path.isStatic());
+        assert(path.type()->size() == sizeof(T));
+        if (vec.size() == 0) {
+            return StridedSpan(nullptr, 0, vec.elementType()->size());
+        }
+        const auto data = vec.template data<Byte>() + path.offset();
+        return StridedSpan(reinterpret_cast<T*>(data), vec.size(), vec.elementType()->size());
+    }
+
+    T& operator[](size_t idx) const
+    {
+        assert(idx < size_);
+        return *reinterpret_cast<T*>(data_ + idx * stride_);
+    }
+
+    Iterator begin() const { return Iterator(data_, stride_); }
+    Iterator end() const { return Iterator(data_ + size_ * stride_, stride_); }
+
+    T* data() const { return reinterpret_cast<T*>(data_); }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t stride() const { return stride_; }
+    bool contiguous() const { return stride_ == sizeof(T); }
+
+    // Copies count elements starting at first into the contiguous array dst
+    void gather(std::remove_cv_t<T>* dst, size_t first, size_t count) const
+    {
+        assert(first + count <= size_);
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            if (contiguous()) {
+                std::memcpy(dst, data_ + first * stride_, count * sizeof(T));
+                return;
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = (*this)[first + i];
+        }
+    }
+
+    void gather(std::remove_cv_t<T>* dst) const { gather(dst, 0, size_); }
+
+    // The opposite of gather: copies the contiguous array src into count elements
+    void scatter(const T* src, size_t first, size_t count) const
+    {
+        static_assert(!std::is_const_v<T>);
+        assert(first + count <= size_);
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            if (contiguous()) {
+                std::memcpy(data_ + first * stride_, src, count * sizeof(T));
+                return;
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            (*this)[first + i] = src[i];
+        }
+    }
+
+    void scatter(const T* src) const { scatter(src, 0, size_); }
+
+private:
+    Byte* data_ = nullptr;
+    size_t size_ = 0;
+    size_t stride_ = 0;
+};
+
+// A bump allocator for short-lived instances (e.g. per frame). reset() destructs everything that
+// was created since the last reset (in reverse order) and reuses the memory. Trivially
+// destructible instances are not tracked at all. Types have to outlive the next reset().
+class Arena {
+public:
+    explicit Arena(size_t blockSize = 64 * 1024)
+        : blockSize_(blockSize)
+    {
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena()
+    {
+        reset();
+        for (const auto& block : blocks_) {
+            ::operator delete(block.data, std::align_val_t { cacheLineSize });
+        }
+    }
+
+    void* allocate(size_t size, size_t alignment)
+    {
+        assert(isPowerOfTwo(alignment));
+        while (currentBlock_ < blocks_.size()) {
+            const auto& block = blocks_[currentBlock_];
+            const auto address = reinterpret_cast<uintptr_t>(block.data) + blockOffset_;
+            const auto start = blockOffset_ + padding(address, alignment);
+            if (start <= block.size && size <= block.size - start) {
+                blockOffset_ = start + size;
+                return block.data + start;
+            }
+            currentBlock_++;
+            blockOffset_ = 0;
+        }
+        // Alignments above cacheLineSize might need up to alignment - 1 bytes of padding
+        const auto extra = alignment > cacheLineSize ? alignment : 0;
+        const auto blockSize = std::max(blockSize_, checkedAdd(size, extra));
+        const auto data = static_cast<std::byte*>(
+            ::operator new(blockSize, std::align_val_t { cacheLineSize }));
+        blocks_.push_back(Block { data, blockSize });
+        currentBlock_ = blocks_.size() - 1;
+        blockOffset_ = 0;
+        return allocate(size, alignment);
+    }
+
+    // Allocates and default-constructs count contiguous instances of type
+    void* create(const Type& type, size_t count = 1)
+    {
+        const auto ptr = allocate(checkedMul(type.size(), count), type.alignment());
+        type.constructN(ptr, count, type.size());
+        track(type, ptr, count);
+        return ptr;
+    }
+
+    // Allocates a copy of the instance of type at src
+    void* copy(const Type& type, const void* src)
+    {
+        const auto ptr = allocate(type.size(), type.alignment());
+        type.copyData(ptr, src);
+        track(type, ptr, 1);
+        return ptr;
+    }
+
+    // The arena keeps a pointer to the type until reset(), so temporaries would dangle
+    void* create(const Type&& type, size_t count = 1) = delete;
+    void* copy(const Type&& type, const void* src) = delete;
+
+    void reset()
+    {
+        for (auto it = destructors_.rbegin(); it != destructors_.rend(); ++it) {
+            it->type->destructN(it->ptr, it->count, it->type->size());
+        }
+        destructors_.clear();
+        currentBlock_ = 0;
+        blockOffset_ = 0;
+    }
+
+    // Total size of all blocks
+    size_t capacity() const
+    {
+        size_t capacity = 0;
+        for (const auto& block : blocks_) {
+            capacity += block.size;
+        }
+        return capacity;
+    }
+
+private:
+    struct Block {
+        std::byte* data;
+        size_t size;
+    };
+
+    struct Destructor {
+        const Type* type;
+        void* ptr;
+        size_t count;
+    };
+
+    void track(const Type& type, void* ptr, size_t count)
+    {
+        if (!type.triviallyDestructible()) {
+            destructors_.push_back(Destructor { &type, ptr, count });
+        }
+    }
+
+    size_t blockSize_;
+    std::vector<Block> blocks_;
+    size_t currentBlock_ = 0;
+    size_t blockOffset_ = 0;
+    std::vector<Destructor> destructors_;
+};
+
+struct PoolHandle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool operator==(const PoolHandle& other) const
+    {
+        return index == other.index && generation == other.generation;
+    }
+    bool operator!=(const PoolHandle& other) const { return !(*this == other); }
+};
+
+// Stores instances of a single type in fixed-size chunks, so their addresses never change.
+// Freed slots are reused (most recently freed first) and their generation is incremented, so
+// handles to freed objects are detected as stale.
+class TypedPool {
+public:
+    explicit TypedPool(TypePtr type, size_t objectsPerChunk = 256)
+        : type_(std::move(type))
+        , stride_(std::max(type_->size(), size_t(1)))
+        , objectsPerChunk_(objectsPerChunk)
+    {
+        assert(objectsPerChunk_ > 0);
+    }
+
+    TypedPool(const TypedPool&) = delete;
+    TypedPool& operator=(const TypedPool&) = delete;
+
+    ~TypedPool()
+    {
+        for (uint32_t i = 0; i < slots_.size(); ++i) {
+            if (slots_[i].alive) {
+                type_->destruct(slotPtr(i));
+            }
+        }
+        for (const auto chunk : chunks_) {
+            ::operator delete(chunk, std::align_val_t { type_->alignment() });
+        }
+    }
+
+    // Allocates and default-constructs an object
+    PoolHandle allocate()
+    {
+        if (freeSlots_.empty()) {
+            addChunk();
+        }
+        const auto index = freeSlots_.back();
+        freeSlots_.pop_back();
+        type_->construct(slotPtr(index));
+        slots_[index].alive = true;
+        size_++;
+        return PoolHandle { index, slots_[index].generation };
+    }
+
+    // Returns false if the handle is stale
+    bool free(PoolHandle handle)
+    {
+        if (!valid(handle)) {
+            return false;
+        }
+        type_->destruct(slotPtr(handle.index));
+        slots_[handle.index].alive = false;
+        slots_[handle.index].generation++;
+        freeSlots_.push_back(handle.index);
+        size_--;
+        return true;
+    }
+
+    bool valid(PoolHandle handle) const
+    {
+        return handle.index < slots_.size() && slots_[handle.index].alive
+            && slots_[handle.index].generation == handle.generation;
+    }
+
+    // Returns nullptr if the handle is stale
+    void* get(PoolHandle handle) { return valid(handle) ? slotPtr(handle.index) : nullptr; }
+
+    template <typename Func>
+    void forEach(Func&& func)
+    {
+        for (uint32_t i = 0; i < slots_.size(); ++i) {
+            if (slots_[i].alive) {
+                func(PoolHandle { i, slots_[i].generation }, slotPtr(i));
+            }
+        }
+    }
+
+    const TypePtr& type() const { return type_; }
+    size_t size() const { return size_; }
+    size_t capacity() const { return slots_.size(); }
+
+private:
+    struct Slot {
+        uint32_t generation = 0;
+        bool alive = false;
+    };
+
+    void* slotPtr(uint32_t index) const
+    {
+        return chunks_[index / objectsPerChunk_] + (index % objectsPerChunk_) * stride_;
+    }
+
+    void addChunk()
+    {
+        const auto bytes = checkedMul(stride_, objectsPerChunk_);
+        chunks_.push_back(static_cast<std::byte*>(
+            ::operator new(bytes, std::align_val_t { type_->alignment() })));
+        const auto first = slots_.size();
+        if (first + objectsPerChunk_ > UINT32_MAX) {
+            throw std::length_error("TypedPool is full");
+        }
+        slots_.resize(first + objectsPerChunk_);
+        // Reversed, so that slots are handed out in ascending order
+        for (auto i = slots_.size(); i > first; --i) {
+            freeSlots_.push_back(static_cast<uint32_t>(i - 1));
+        }
+    }
+
+    TypePtr type_;
+    size_t stride_;
+    size_t objectsPerChunk_;
+    std::vector<std::byte*> chunks_;
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> freeSlots_;
+    size_t size_ = 0;
+};
+
+using ComponentId = uint32_t;
+using Entity = PoolHandle;
+
+// Stores components of entities grouped by archetype (the set of components an entity has).
+// Each archetype stores its rows in chunks of chunkBytes, which contain one contiguous column
+// per component, so iterating a component is a linear scan. Rows are kept dense by moving the
+// last row into the hole when an entity leaves an archetype.
+class ArchetypeStorage {
+    struct Archetype;
+
+public:
+    static constexpr size_t chunkBytes = 16 * 1024;
+
+    ArchetypeStorage() { findOrCreateArchetype({}); }
+
+    ArchetypeStorage(const ArchetypeStorage&) = delete;
+    ArchetypeStorage& operator=(const ArchetypeStorage&) = delete;
+
+    ~ArchetypeStorage()
+    {
+        for (auto& archetype : archetypes_) {
+            for (size_t c = 0; c < archetype.chunks.size(); ++c) {
+                const auto rows = std::min(archetype.chunkCapacity,
+                    archetype.entities.size() - c * archetype.chunkCapacity);
+                for (size_t col = 0; col < archetype.components.size(); ++col) {
+                    const auto& type = components_[archetype.components[col]];
+                    type->destructN(archetype.chunks[c] + archetype.columnOffsets[col], rows,
+                        type->size());
+                }
+                freeChunk(archetype, archetype.chunks[c]);
+            }
+        }
+    }
+
+    ComponentId registerComponent(TypePtr type)
+    {
+        components_.push_back(std::move(type));
+        return static_cast<ComponentId>(components_.size() - 1);
+    }
+
+    const TypePtr& componentType(ComponentId component) const { return components_[component]; }
+
+    // Creates an entity without components
+    Entity createEntity()
+    {
+        uint32_t index;
+        if (freeEntities_.empty()) {
+            index = static_cast<uint32_t>(entities_.size());
+            entities_.emplace_back();
+        } else {
+            index = freeEntities_.back();
+            freeEntities_.pop_back();
+        }
+        auto& record = entities_[index];
+        record.alive = true;
+        record.archetype = 0;
+        record.row = addRow(archetypes_[0], index);
+        return Entity { index, record.generation };
+    }
+
+    void destroyEntity(Entity entity)
+    {
+        assert(alive(entity));
+        auto& record = entities_[entity.index];
+        removeRow(record.archetype, record.row, true);
+        record.alive = false;
+        record.generation++;
+        freeEntities_.push_back(entity.index);
+    }
+
+    bool alive(Entity entity) const
+    {
+        return entity.index < entities_.size() && entities_[entity.index].alive
+            && entities_[entity.index].generation == entity.generation;
+    }
+
+    // Default-constructs the component and returns a pointer to it, which is valid until the
+    // next structural change of the storage. Returns the existing component if there is one.
+    void* addComponent(Entity entity, ComponentId component)
+    {
+        assert(alive(entity));
+        if (const auto existing = getComponent(entity, component)) {
+            return existing;
+        }
+        const auto& record = entities_[entity.index];
+        const auto target = addEdge(record.archetype, component);
+        moveEntity(entity.index, target);
+        auto& archetype = archetypes_[target];
+        const auto ptr = componentPtr(archetype, columnIndex(archetype, component), record.row);
+        components_[component]->construct(ptr);
+        return ptr;
+    }
+
+    void removeComponent(Entity entity, ComponentId component)
+    {
+        assert(alive(entity));
+        const auto& record = entities_[entity.index];
+        auto& archetype = archetypes_[record.archetype];
+        const auto column = columnIndex(archetype, component);
+        if (column == archetype.components.size()) {
+            return;
+        }
+        components_[component]->destruct(componentPtr(archetype, column, record.row));
+        moveEntity(entity.index, removeEdge(record.archetype, component));
+    }
+
+    // Returns nullptr if the entity does not have the component
+    void* getComponent(Entity entity, ComponentId component)
+    {
+        assert(alive(entity));
+        const auto& record = entities_[entity.index];
+        auto& archetype = archetypes_[record.archetype];
+        const auto column = columnIndex(archetype, component);
+        if (column == archetype.components.size()) {
+            return nullptr;
+        }
+        return componentPtr(archetype, column, record.row);
+    }
+
+    bool hasComponent(Entity entity, ComponentId component)
+    {
+        return getComponent(entity, component) != nullptr;
+    }
+
+    class ChunkView {
+    public:
+        // Returns the contiguous column of the component or nullptr if it is not in the chunk
+        void* column(ComponentId component) const
+        {
+            const auto col = columnIndex(*archetype_, component);
+            return col < archetype_->components.size()
+                ? data_ + archetype_->columnOffsets[col]
+                : nullptr;
+        }
+
+        template <typename T>
+        T* column(ComponentId component) const
+        {
+            return reinterpret_cast<T*>(column(component));
+        }
+
+        size_t size() const { return size_; }
+
+    private:
+        friend class ArchetypeStorage;
+
+        ChunkView(const Archetype* archetype, std::byte* data, size_t size)
+            : archetype_(archetype)
+            , data_(data)
+            , size_(size)
+        {
+        }
+
+        const Archetype* archetype_;
+        std::byte* data_;
+        size_t size_;
+    };
+
+    // Calls func(const ChunkView&) for every chunk of every archetype that has all components
+    template <typename Func>
+    void forEachChunk(const std::vector<ComponentId>& query, Func&& func)
+    {
+        for (auto& archetype : archetypes_) {
+            const auto matches = std::all_of(query.begin(), query.end(), [&](ComponentId c) {
+                return columnIndex(archetype, c) < archetype.components.size();
+            });
+            if (!matches) {
+                continue;
+            }
+            for (size_t c = 0; c < archetype.chunks.size(); ++c) {
+                const auto rows = std::min(archetype.chunkCapacity,
+                    archetype.entities.size() - c * archetype.chunkCapacity);
+                if (rows > 0) {
+                    func(ChunkView(&archetype, archetype.chunks[c], rows));
+                }
+            }
+        }
+    }
+
+    size_t archetypeCount() const { return archetypes_.size(); }
+
+private:
+    struct Archetype {
+        std::vector<ComponentId> components; // sorted
+        std::vector<size_t> columnOffsets; // relative to the start of a chunk
+        std::vector<size_t> columnStrides; // size of the component
+        size_t chunkCapacity; // rows per chunk
+        size_t chunkSize;
+        size_t chunkAlignment;
+        std::vector<std::byte*> chunks;
+        std::vector<uint32_t> entities; // entity index of each row
+        std::unordered_map<ComponentId, size_t> addEdges;
+        std::unordered_map<ComponentId, size_t> removeEdges;
+    };
+
+    struct EntityRecord {
+        uint32_t generation = 0;
+        bool alive = false;
+        size_t archetype = 0;
+        size_t row = 0;
+    };
+
+    // Returns components.size() if the archetype does not have the component
+    static size_t columnIndex(const Archetype& archetype, ComponentId component)
+    {
+        const auto& comps = archetype.components;
+        const auto it = std::lower_bound(comps.begin(), comps.end(), component);
+        return it != comps.end() && *it == component ? static_cast<size_t>(it - comps.begin())
+                                                     : comps.size();
+    }
+
+    static void* componentPtr(Archetype& archetype, size_t column, size_t row)
+    {
+        const auto chunk = archetype.chunks[row / archetype.chunkCapacity];
+        return chunk + archetype.columnOffsets[column]
+            + (row % archetype.chunkCapacity) * archetype.columnStrides[column];
+    }
+
+    Archetype makeArchetype(std::vector<ComponentId> components) const
+    {
+        Archetype archetype;
+        archetype.components = std::move(components);
+        size_t rowBytes = 0;
+        archetype.chunkAlignment = cacheLineSize;
+        for (const auto component : archetype.components) {
+            archetype.columnStrides.push_back(components_[component]->size());
+            rowBytes += components_[component]->size();
+            archetype.chunkAlignment
+                = std::max(archetype.chunkAlignment, components_[component]->alignment());
+        }
+
+        // Shrink the capacity until the columns including their padding fit into a chunk
+        auto capacity = rowBytes > 0 ? std::max(chunkBytes / rowBytes, size_t(1)) : chunkBytes;
+        while (true) {
+            archetype.columnOffsets.clear();
+            size_t offset = 0;
+            for (const auto component : archetype.components) {
+                const auto& type = components_[component];
+                offset = align(offset, type->alignment());
+                archetype.columnOffsets.push_back(offset);
+                offset = checkedAdd(offset, checkedMul(type->size(), capacity));
+            }
+            if (offset <= chunkBytes || capacity == 1) {
+                archetype.chunkCapacity = capacity;
+                archetype.chunkSize = std::max(offset, size_t(1));
+                return archetype;
+            }
+            capacity--;
+        }
+    }
+
+    size_t findOrCreateArchetype(std::vector<ComponentId> components)
+    {
+        const auto it = archetypeIndex_.find(components);
+        if (it != archetypeIndex_.end()) {
+            return it->second;
+        }
+        archetypes_.push_back(makeArchetype(components));
+        archetypeIndex_.emplace(std::move(components), archetypes_.size() - 1);
+        return archetypes_.size() - 1;
+    }
+
+    size_t addEdge(size_t from, ComponentId component)
+    {
+        const auto it = archetypes_[from].addEdges.find(component);
+        if (it != archetypes_[from].addEdges.end()) {
+            return it->second;
+        }
+        auto components = archetypes_[from].components;
+        components.insert(
+            std::lower_bound(components.begin(), components.end(), component), component);
+        const auto to = findOrCreateArchetype(std::move(components));
+        archetypes_[from].addEdges[component] = to;
+        archetypes_[to].removeEdges[component] = from;
+        return to;
+    }
+
+    size_t removeEdge(size_t from, ComponentId component)
+    {
+        const auto it = archetypes_[from].removeEdges.find(component);
+        if (it != archetypes_[from].removeEdges.end()) {
+            return it->second;
+        }
+        auto components = archetypes_[from].components;
+        components.erase(std::find(components.begin(), components.end(), component));
+        const auto to = findOrCreateArchetype(std::move(components));
+        archetypes_[from].removeEdges[component] = to;
+        archetypes_[to].addEdges[component] = from;
+        return to;
+    }
+
+    static void freeChunk(const Archetype& archetype, std::byte* chunk)
+    {
+        ::operator delete(chunk, std::align_val_t { archetype.chunkAlignment });
+    }
+
+    // Appends an uninitialized row
+    size_t addRow(Archetype& archetype, uint32_t entity)
+    {
+        const auto row = archetype.entities.size();
+        if (row == archetype.chunks.size() * archetype.chunkCapacity) {
+            archetype.chunks.push_back(static_cast<std::byte*>(::operator new(
+                archetype.chunkSize, std::align_val_t { archetype.chunkAlignment })));
+        }
+        archetype.entities.push_back(entity);
+        return row;
+    }
+
+    // Fills the hole with the last row. If destruct is false, the components of the row have
+    // been relocated or destructed already.
+    void removeRow(size_t archetypeIndex, size_t row, bool destruct)
+    {
+        auto& archetype = archetypes_[archetypeIndex];
+        const auto last = archetype.entities.size() - 1;
+        for (size_t col = 0; col < archetype.components.size(); ++col) {
+            const auto& type = components_[archetype.components[col]];
+            if (destruct) {
+                type->destruct(componentPtr(archetype, col, row));
+            }
+            if (row != last) {
+                type->relocate(
+                    componentPtr(archetype, col, row), componentPtr(archetype, col, last), 1);
+            }
+        }
+        if (row != last) {
+            archetype.entities[row] = archetype.entities[last];
+            entities_[archetype.entities[row]].row = row;
+        }
+        archetype.entities.pop_back();
+        if (archetype.entities.size() <= (archetype.chunks.size() - 1) * archetype.chunkCapacity) {
+            freeChunk(archetype, archetype.chunks.back());
+            archetype.chunks.pop_back();
+        }
+    }
+
+    // Relocates all components the entity has in both archetypes. Components that are not in
+    // the target archetype have to be destructed already and new ones are left uninitialized.
+    void moveEntity(uint32_t entity, size_t targetIndex)
+    {
+        auto& record = entities_[entity];
+        const auto sourceIndex = record.archetype;
+        const auto sourceRow = record.row;
+        const auto targetRow = addRow(archetypes_[targetIndex], entity);
+        auto& source = archetypes_[sourceIndex];
+        auto& target = archetypes_[targetIndex];
+        for (size_t col = 0; col < source.components.size(); ++col) {
+            const auto targetCol = columnIndex(target, source.components[col]);
+            if (targetCol < target.components.size()) {
+                components_[source.components[col]]->relocate(
+                    componentPtr(target, targetCol, targetRow),
+                    componentPtr(source, col, sourceRow), 1);
+            }
+        }
+        removeRow(sourceIndex, sourceRow, false);
+        record.archetype = targetIndex;
+        record.row = targetRow;
+    }
+
+    std::vector<TypePtr> components_;
+    std::vector<Archetype> archetypes_;
+    std::map<std::vector<ComponentId>, size_t> archetypeIndex_;
+    std::vector<EntityRecord> entities_;
+    std::vector<uint32_t> freeEntities_;
+};
+
+// Bulk arithmetic over numeric columns. Arrays are given as (pointer, count, stride in bytes),
+// so they may be fields of structs in an array as well. Contiguous float arrays use SIMD kernels
+// for the widest instruction set the CPU supports, everything else is a plain loop.
+namespace simd {
+    enum class Isa {
+        Sse2, // 128 bit. This is the fallback and maps to whatever the target has (e.g. NEON).
+        Avx2,
+        Avx512,
+    };
+
+    struct FloatKernels {
+        void (*fill)(float* dst, size_t count, float value);
+        void (*scale)(float* dst, size_t count, float factor); // dst *= factor
+        void (*axpy)(float* dst, const float* src, size_t count, float a); // dst += a * src
+        void (*add)(float* dst, const float* src, size_t count); // dst += src
+        void (*mul)(float* dst, const float* src, size_t count); // dst *= src
+        void (*clamp)(float* dst, size_t count, float lo, float hi);
+        void (*lerp)(float* dst, const float* src, size_t count, float t); // dst += (src - dst) * t
+        float (*sum)(const float* src, size_t count);
+        float (*min)(const float* src, size_t count); // count must not be 0
+        float (*max)(const float* src, size_t count); // count must not be 0
+    };
+
+    namespace detail {
+// The kernels are written once with GCC vector extensions and always inlined into functions
+// compiled for a specific instruction set, which determines the instructions they use.
+#define RTTYPES_ALWAYS_INLINE __attribute__((always_inline)) inline
+
+        // Unaligned and allowed to alias floats, so float arrays can be accessed through it.
+        // Vectors are never passed by value, which would depend on the instruction set.
+        template <size_t Width>
+        struct FloatVec {
+            typedef float Type __attribute__((
+                vector_size(Width * sizeof(float)), aligned(alignof(float)), may_alias));
+        };
+
+        // The return types must not be deduced, because that would drop the alignment attribute
+        template <size_t Width>
+        RTTYPES_ALWAYS_INLINE typename FloatVec<Width>::Type& vec(float* ptr)
+        {
+            return *reinterpret_cast<typename FloatVec<Width>::Type*>(ptr);
+        }
+
+        template <size_t Width>
+        RTTYPES_ALWAYS_INLINE const typename FloatVec<Width>::Type& vec(const float* ptr)
+        {
+            return *reinterpret_cast<const typename FloatVec<Width>::Type*>(ptr);
+        }
+
+        template <size_t Width>
+        RTTYPES_ALWAYS_INLINE void fill(float* dst, size_t count, float value)
+        {
+            const typename FloatVec<Width>::Type v = {};
+            size_t i = 0;
+            for (; i + Width <= count; i += Width) {
+                vec<Width>(dst + i) = v + value;
+            }
+            for (; i < count; ++i) {
+                dst[i] = value;
+            }
+        }
+
+        template <size_t Width>
+        RTTYPES_ALWAYS_INLINE void scale(float* dst, size_t count, float factor)
+        {
+            size_t i = 0;
+            for (; i + Width <= count; i += Width) {
+                vec<Width>(dst + i) *= factor;
+            }
+            for (; i < count; ++i) {
+                dst[i] *= factor;
+            }
+        }
+
+        template <size_t Width>
+        RTTYPES_ALWAYS_INLINE void axpy(float* dst, const float* src, size_t count, float a)
+        {
+            size_t i = 0;
+            for (; i + Width <= count; i += Width) {
+                vec<Width>(dst + i) += vec<Width>(src + i) * a;
+            }
+            for (; i < count; ++i) {
+                dst[i] += src[i] * a;
+            }
+        }
+
+        template <size_t Width>
+        RTTYPES_ALWAYS_INLINE void add(float* dst, const float* src, size_t count)
+        {
+            size_t i = 0;
+            for (; i + Width <= count; i += Width) {
+                vec<Width>(dst + i) += vec<Width>(src + i);
+            }
+            for (; i < count; ++i) {
+                dst[i] += src[i];
+            }
+        }
+
+        template <size_t Width>
+        RTTYPES_ALWAYS_INLINE void mul(float* dst, const float* src, size_t count)
+        {
+            size_t i = 0;
+            for (; i + Width <= count; i += Width) {
+                vec<Width>(dst + i) *= vec<Width>(src + i);
+            }
+            for (; i < count; ++i) {
+                dst[i] *= src[i];
+            }
+        }
+
+        template <size_t Width>
+        RTTYPES_ALWAYS_INLINE void clamp(float* dst, size_t count, float lo, float hi)
+        {
+            const typename FloatVec<Width>::Type zero = {};
+            const auto vlo = zero + lo;
+            const auto vhi = zero + hi;
+            size_t i = 0;
+            for (; i + Width <= count; i += Width) {
+                typename FloatVec<Width>::Type& v = vec<Width>(dst + i);
+                v = v < vlo ? vlo : v;
+                v = v > vhi ? vhi : v;
+            }
+            for (; i < count; ++i) {
+                dst[i] = std::min(std::max(dst[i], lo), hi);
+            }
+        }
+
+        template <size_t Width>
+        RTTYPES_ALWAYS_INLINE void lerp(float* dst, const float* src, size_t count, float t)
+        {
+            size_t i = 0;
+            for (; i + Width <= count; i += Width) {
+                typename FloatVec<Width>::Type& d = vec<Width>(dst + i);
+                d += (vec<Width>(src + i) - d) * t;
+            }
+            for (; i < count; ++i) {
+                dst[i] += (src[i] - dst[i]) * t;
+            }
+        }
+
+        template <size_t Width>
+        RTTYPES_ALWAYS_INLINE float sum(const float* src, size_t count)
+        {
+            typename FloatVec<Width>::Type acc = {};
+            size_t i = 0;
+            for (; i + Width <= count; i += Width) {
+                acc += vec<Width>(src + i);
+            }
+            float result = 0.0f;
+            for (size_t lane = 0; lane < Width; ++lane) {
+                result += acc[lane];
+            }
+            for (; i < count; ++i) {
+                result += src[i];
+            }
+            return result;
+        }
+
+        template <size_t Width, bool Max>
+        RTTYPES_ALWAYS_INLINE float minMax(const float* src, size_t count)
+        {
+            assert(count > 0);
+            float result = src[0];
+            size_t i = 0;
+            if (count >= Width) {
+                typename FloatVec<Width>::Type acc = vec<Width>(src);
+                for (i = Width; i + Width <= count; i += Width) {
+                    const typename FloatVec<Width>::Type& v = vec<Width>(src + i);
+                    acc = (Max ? v > acc : v < acc) ? v : acc;
+                }
+                for (size_t lane = 0; lane < Width; ++lane) {
+                    result = Max ? std::max(result, acc[lane]) : std::min(result, acc[lane]);
+                }
+            }
+            for (; i < count; ++i) {
+                result = Max ? std::max(result, src[i]) : std::min(result, src[i]);
+            }
+            return result;
+        }
+
+// Defines functions with a target attribute, that contain the inlined kernels for Width
+#define RTTYPES_DEFINE_FLOAT_KERNELS(Name, Width, Target)                                          \
+    struct Name {                                                                                  \
+        Target static void fill(float* d, size_t n, float v)                                       \
+        {                                                                                          \
+            detail::fill<Width>(d, n, v);                                                          \
+        }                                                                                          \
+        Target static void scale(float* d, size_t n, float f)                                      \
+        {                                                                                          \
+            detail::scale<Width>(d, n, f);                                                         \
+        }                                                                                          \
+        Target static void axpy(float* d, const float* s, size_t n, float a)                       \
+        {                                                                                          \
+            detail::axpy<Width>(d, s, n, a);                                                       \
+        }                                                                                          \
+        Target static void add(float* d, const float* s, size_t n)                                 \
+        {                                                                                          \
+            detail::add<Width>(d, s, n);                                                           \
+        }                                                                                          \
+        Target static void mul(float* d, const float* s, size_t n)                                 \
+        {                                                                                          \
+            detail::mul<Width>(d, s, n);                                                           \
+        }                                                                                          \
+        Target static void clamp(float* d, size_t n, float lo, float hi)                           \
+        {                                                                                          \
+            detail::clamp<Width>(d, n, lo, hi);                                                    \
+        }                                                                                          \
+        Target static void lerp(float* d, const float* s, size_t n, float t)                       \
+        {                                                                                          \
+            detail::lerp<Width>(d, s, n, t);                                                       \
+        }                                                                                          \
+        Target static float sum(const float* s, size_t n)                                          \
+        {                                                                                          \
+            return detail::sum<Width>(s, n);                                                       \
+        }                                                                                          \
+        Target static float min(const float* s, size_t n)                                          \
+        {                                                                                          \
+            return detail::minMax<Width, false>(s, n);                                             \
+        }                                                                                          \
+        Target static float max(const float* s, size_t n)                                          \
+        {                                                                                          \
+            return detail::minMax<Width, true>(s, n);                                              \
+        }                                                                                          \
+        static constexpr FloatKernels kernels {                                                    \
+            fill, scale, axpy, add, mul, clamp, lerp, sum, min, max                                \
+        };                                                                                         \
+    };
+
+        RTTYPES_DEFINE_FLOAT_KERNELS(Sse2Kernels, 4, )
+#if defined(__x86_64__) || defined(__i386__)
+        RTTYPES_DEFINE_FLOAT_KERNELS(Avx2Kernels, 8, __attribute__((target("avx2"))))
+        RTTYPES_DEFINE_FLOAT_KERNELS(Avx512Kernels, 16, __attribute__((target("avx512f"))))
+#endif
+
+#undef RTTYPES_DEFINE_FLOAT_KERNELS
+#undef RTTYPES_ALWAYS_INLINE
 
-        void* fieldPtr(std::string_view name)
+        template <typename T>
+        T& strided(T* base, size_t index, size_t stride)
         {
-            return fieldPtr(struct_->getFieldIndex(name).value());
+            return *reinterpret_cast<T*>(offset(static_cast<void*>(base), index * stride));
         }
 
         template <typename T>
-        T& field(size_t index)
+        const T& strided(const T* base, size_t index, size_t stride)
         {
-            return *reinterpret_cast<T*>(fieldPtr(index));
+            const auto ptr = offset(static_cast<const void*>(base), index * stride);
+            return *reinterpret_cast<const T*>(ptr);
         }
 
         template <typename T>
-        T& field(std::string_view name)
+        struct Identity {
+            using Type = T;
+        };
+
+        // Keeps T from being deduced from a parameter
+        template <typename T>
+        using NonDeduced = typename Identity<T>::Type;
+
+        template <typename T>
+        bool holds(const VectorData& vec)
         {
-            return field<T>(struct_->getFieldIndex(name).value());
+            return dynamic_cast<const ConcreteType<T>*>(vec.elementType()) != nullptr;
         }
+    }
 
-    private:
-        const Struct* struct_;
-        void* ptr_;
-    };
+    inline Isa detectIsa()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return Isa::Avx512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return Isa::Avx2;
+        }
+#endif
+        return Isa::Sse2;
+    }
 
-    template <typename FieldType>
-    size_t addField(std::string name, const FieldType& type)
+    // Falls back to the widest available kernels, if isa is not supported by the build target
+    inline const FloatKernels& floatKernels(Isa isa)
     {
-        currentOffset_ = align(currentOffset_, type.alignment());
-        fields_.push_back(Field { std::move(name), type.copy(), currentOffset_ });
-        currentOffset_ += type.size();
+#if defined(__x86_64__) || defined(__i386__)
+        if (isa == Isa::Avx512) {
+            return detail::Avx512Kernels::kernels;
+        }
+        if (isa == Isa::Avx2) {
+            return detail::Avx2Kernels::kernels;
+        }
+#endif
+        (void)isa;
+        return detail::Sse2Kernels::kernels;
+    }
 
-        alignment_ = std::max(alignment_, type.alignment());
-        size_ = align(currentOffset_, alignment_);
+    // The kernels for the CPU we are running on
+    inline const FloatKernels& floatKernels()
+    {
+        static const auto& kernels = floatKernels(detectIsa());
+        return kernels;
+    }
 
-        return fields_.size() - 1;
+    template <typename T>
+    void fill(T* dst, size_t count, size_t stride, T value)
+    {
+        if constexpr (std::is_same_v<T, float>) {
+            if (stride == sizeof(float)) {
+                return floatKernels().fill(dst, count, value);
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            detail::strided(dst, i, stride) = value;
+        }
     }
 
-    std::optional<size_t> getFieldIndex(std::string_view name) const
+    template <typename T>
+    void scale(T* dst, size_t count, size_t stride, T factor)
     {
-        for (size_t i = 0; i < fields_.size(); ++i) {
-            if (fields_[i].name == name) {
-                return i;
+        if constexpr (std::is_same_v<T, float>) {
+            if (stride == sizeof(float)) {
+                return floatKernels().scale(dst, count, factor);
             }
         }
-        return std::nullopt;
+        for (size_t i = 0; i < count; ++i) {
+            detail::strided(dst, i, stride) *= factor;
+        }
     }
 
-    View view(void* ptr) const { return View(this, ptr); }
-    // ConstView view(const void* ptr) const { return View(this, ptr); }
+    template <typename T>
+    void axpy(T* dst, size_t dstStride, const T* src, size_t srcStride, size_t count, T a)
+    {
+        if constexpr (std::is_same_v<T, float>) {
+            if (dstStride == sizeof(float) && srcStride == sizeof(float)) {
+                return floatKernels().axpy(dst, src, count, a);
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            detail::strided(dst, i, dstStride) += detail::strided(src, i, srcStride) * a;
+        }
+    }
 
-    const Field& field(size_t index) const { return fields_[index]; }
-    const Field& field(std::string_view name) const { return fields_[getFieldIndex(name).value()]; }
+    template <typename T>
+    void add(T* dst, size_t dstStride, const T* src, size_t srcStride, size_t count)
+    {
+        if constexpr (std::is_same_v<T, float>) {
+            if (dstStride == sizeof(float) && srcStride == sizeof(float)) {
+                return floatKernels().add(dst, src, count);
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            detail::strided(dst, i, dstStride) += detail::strided(src, i, srcStride);
+        }
+    }
 
-    std::unique_ptr<Type> copy() const override { return std::make_unique<Struct>(*this); }
+    template <typename T>
+    void mul(T* dst, size_t dstStride, const T* src, size_t srcStride, size_t count)
+    {
+        if constexpr (std::is_same_v<T, float>) {
+            if (dstStride == sizeof(float) && srcStride == sizeof(float)) {
+                return floatKernels().mul(dst, src, count);
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            detail::strided(dst, i, dstStride) *= detail::strided(src, i, srcStride);
+        }
+    }
 
-    void copyData(void* dest, const void* src) const override
+    template <typename T>
+    void clamp(T* dst, size_t count, size_t stride, T lo, T hi)
     {
-        construct(dest);
-        for (const auto& field : fields_) {
-            field.type->copyData(offset(dest, field.offset), offset(src, field.offset));
+        if constexpr (std::is_same_v<T, float>) {
+            if (stride == sizeof(float)) {
+                return floatKernels().clamp(dst, count, lo, hi);
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            auto& v = detail::strided(dst, i, stride);
+            v = std::min(std::max(v, lo), hi);
         }
     }
 
-    void construct(void* ptr) const override
+    template <typename T>
+    void lerp(T* dst, size_t dstStride, const T* src, size_t srcStride, size_t count, T t)
     {
-        for (const auto& field : fields_) {
-            field.type->construct(offset(ptr, field.offset));
+        if constexpr (std::is_same_v<T, float>) {
+            if (dstStride == sizeof(float) && srcStride == sizeof(float)) {
+                return floatKernels().lerp(dst, src, count, t);
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            auto& d = detail::strided(dst, i, dstStride);
+            d += (detail::strided(src, i, srcStride) - d) * t;
         }
     }
 
-    void destruct(void* ptr) const override
+    template <typename T>
+    T sum(const T* src, size_t count, size_t stride)
     {
-        for (const auto& field : fields_) {
-            field.type->destruct(offset(ptr, field.offset));
+        if constexpr (std::is_same_v<T, float>) {
+            if (stride == sizeof(float)) {
+                return floatKernels().sum(src, count);
+            }
         }
+        T result {};
+        for (size_t i = 0; i < count; ++i) {
+            result += detail::strided(src, i, stride);
+        }
+        return result;
     }
 
-private:
-    std::vector<Field> fields_;
-    size_t currentOffset_ = 0;
-};
+    // count must not be 0
+    template <typename T>
+    T min(const T* src, size_t count, size_t stride)
+    {
+        if constexpr (std::is_same_v<T, float>) {
+            if (stride == sizeof(float)) {
+                return floatKernels().min(src, count);
+            }
+        }
+        assert(count > 0);
+        auto result = src[0];
+        for (size_t i = 1; i < count; ++i) {
+            result = std::min(result, detail::strided(src, i, stride));
+        }
+        return result;
+    }
 
-class VectorData {
-public:
-    template <typename ElementType>
-    VectorData(const ElementType& elementType)
-        : elementType_(elementType.copy())
+    // count must not be 0
+    template <typename T>
+    T max(const T* src, size_t count, size_t stride)
     {
+        if constexpr (std::is_same_v<T, float>) {
+            if (stride == sizeof(float)) {
+                return floatKernels().max(src, count);
+            }
+        }
+        assert(count > 0);
+        auto result = src[0];
+        for (size_t i = 1; i < count; ++i) {
+            result = std::max(result, detail::strided(src, i, stride));
+        }
+        return result;
     }
 
-    ~VectorData()
+    // Overloads for vectors with a numeric element type T. T has to be named explicitly, e.g.
+    // fill<float>(vec, 0), so that it can not be deduced wrongly from a scalar argument.
+
+    template <typename T>
+    void fill(VectorData& dst, detail::NonDeduced<T> value)
     {
-        resize(0);
-        delete[] data_;
+        assert(detail::holds<T>(dst));
+        fill(dst.data<T>(), dst.size(), sizeof(T), value);
     }
 
-    VectorData& operator=(const VectorData& other)
+    template <typename T>
+    void scale(VectorData& dst, detail::NonDeduced<T> factor)
     {
-        resize(other.size_);
-        for (size_t i = 0; i < other.size_; ++i) {
-            elementType_->copyData(indexPtr(i), other.indexPtr(i));
-        }
-        return *this;
+        assert(detail::holds<T>(dst));
+        scale(dst.data<T>(), dst.size(), sizeof(T), factor);
     }
 
-    void* indexPtr(size_t idx) { return data_ + idx * elementType_->size(); }
-    const void* indexPtr(size_t idx) const { return data_ + idx * elementType_->size(); }
+    template <typename T>
+    void axpy(VectorData& dst, const VectorData& src, detail::NonDeduced<T> a)
+    {
+        assert(detail::holds<T>(dst) && detail::holds<T>(src));
+        assert(dst.size() == src.size());
+        axpy(dst.data<T>(), sizeof(T), src.data<T>(), sizeof(T), dst.size(), a);
+    }
 
     template <typename T>
-    T& index(size_t idx)
+    void add(VectorData& dst, const VectorData& src)
     {
-        assert(sizeof(T) == elementType_->size());
-        assert(idx < size_);
-        return *reinterpret_cast<T*>(indexPtr(idx));
+        assert(detail::holds<T>(dst) && detail::holds<T>(src));
+        assert(dst.size() == src.size());
+        add(dst.data<T>(), sizeof(T), src.data<T>(), sizeof(T), dst.size());
     }
 
-    void grow(size_t num = 1) { resize(size_ + num); }
+    template <typename T>
+    void mul(VectorData& dst, const VectorData& src)
+    {
+        assert(detail::holds<T>(dst) && detail::holds<T>(src));
+        assert(dst.size() == src.size());
+        mul(dst.data<T>(), sizeof(T), src.data<T>(), sizeof(T), dst.size());
+    }
 
-    void resize(size_t newSize)
+    template <typename T>
+    void clamp(VectorData& dst, detail::NonDeduced<T> lo, detail::NonDeduced<T> hi)
     {
-        if (newSize > size_) {
-            if (capacity_ < newSize) {
-                const auto newCapacity = std::max(size_ * 2, newSize);
-                const auto newData = new std::byte[newCapacity * elementType_->size()];
-                for (size_t i = 0; i < size_; ++i) {
-                    elementType_->copyData(newData + i * elementType_->size(), indexPtr(i));
-                }
-                delete[] data_;
-                data_ = newData;
-                capacity_ = newCapacity;
-            }
-            std::memset(indexPtr(size_), 0, (newSize - size_) * elementType_->size());
-            for (size_t i = size_; i < newSize; ++i) {
-                elementType_->construct(indexPtr(i));
-            }
-        } else {
-            for (size_t i = newSize; i < size_; ++i) {
-                elementType_->destruct(indexPtr(i));
-            }
-        }
-        size_ = newSize;
+        assert(detail::holds<T>(dst));
+        clamp(dst.data<T>(), dst.size(), sizeof(T), lo, hi);
     }
 
-    template <typename T = void>
-    T* data()
+    template <typename T>
+    void lerp(VectorData& dst, const VectorData& src, detail::NonDeduced<T> t)
     {
-        return data_;
+        assert(detail::holds<T>(dst) && detail::holds<T>(src));
+        assert(dst.size() == src.size());
+        lerp(dst.data<T>(), sizeof(T), src.data<T>(), sizeof(T), dst.size(), t);
     }
 
-    size_t size() const { return size_; }
+    template <typename T>
+    T sum(const VectorData& src)
+    {
+        assert(detail::holds<T>(src));
+        return sum(src.data<T>(), src.size(), sizeof(T));
+    }
 
-    size_t capacity() const { return capacity_; }
+    template <typename T>
+    T min(const VectorData& src)
+    {
+        assert(detail::holds<T>(src));
+        return min(src.data<T>(), src.size(), sizeof(T));
+    }
 
-    Type* elementType() const { return elementType_.get(); }
+    template <typename T>
+    T max(const VectorData& src)
+    {
+        assert(detail::holds<T>(src));
+        return max(src.data<T>(), src.size(), sizeof(T));
+    }
 
-private:
-    std::unique_ptr<Type> elementType_;
-    std::byte* data_ = nullptr;
-    size_t size_ = 0;
-    size_t capacity_ = 0; // size of data_ is capacity_ * elementType_->size()
-};
+    // Overloads for spans, e.g. of a numeric field of a vector of structs. These only use the
+    // SIMD kernels if the span is contiguous. T is deduced from the span only.
 
-class Vector : public Type {
-public:
-    template <typename ElementType>
-    Vector(const ElementType& elementType)
-        : Type(sizeof(VectorData), std::alignment_of_v<VectorData>)
-        , elementType_(elementType.copy())
+    template <typename T>
+    void fill(const StridedSpan<T>& dst, detail::NonDeduced<T> value)
+    {
+        fill(dst.data(), dst.size(), dst.stride(), value);
+    }
+
+    template <typename T>
+    void scale(const StridedSpan<T>& dst, detail::NonDeduced<T> factor)
     {
+        scale(dst.data(), dst.size(), dst.stride(), factor);
     }
 
-    Vector(const Vector& other)
-        : Type(sizeof(VectorData), std::alignment_of_v<VectorData>)
-        , elementType_(other.elementType_->copy())
+    template <typename T, typename U>
+    void axpy(const StridedSpan<T>& dst, const StridedSpan<U>& src, detail::NonDeduced<T> a)
     {
+        static_assert(std::is_same_v<T, std::remove_const_t<U>>);
+        assert(dst.size() == src.size());
+        axpy<T>(dst.data(), dst.stride(), src.data(), src.stride(), dst.size(), a);
     }
 
-    VectorData& view(void* ptr) const { return *reinterpret_cast<VectorData*>(ptr); }
+    template <typename T, typename U>
+    void add(const StridedSpan<T>& dst, const StridedSpan<U>& src)
+    {
+        static_assert(std::is_same_v<T, std::remove_const_t<U>>);
+        assert(dst.size() == src.size());
+        add<T>(dst.data(), dst.stride(), src.data(), src.stride(), dst.size());
+    }
 
-    std::unique_ptr<Type> copy() const override { return std::make_unique<Vector>(*this); }
+    template <typename T, typename U>
+    void mul(const StridedSpan<T>& dst, const StridedSpan<U>& src)
+    {
+        static_assert(std::is_same_v<T, std::remove_const_t<U>>);
+        assert(dst.size() == src.size());
+        mul<T>(dst.data(), dst.stride(), src.data(), src.stride(), dst.size());
+    }
 
-    void copyData(void* dest, const void* src) const override
+    template <typename T>
+    void clamp(
+        const StridedSpan<T>& dst, detail::NonDeduced<T> lo, detail::NonDeduced<T> hi)
     {
-        construct(dest);
-        view(dest) = *reinterpret_cast<const VectorData*>(src);
+        clamp(dst.data(), dst.size(), dst.stride(), lo, hi);
     }
 
-    void construct(void* ptr) const override { new (ptr) VectorData { *elementType_ }; }
-    void destruct(void* ptr) const override { reinterpret_cast<VectorData*>(ptr)->~VectorData(); }
+    template <typename T, typename U>
+    void lerp(const StridedSpan<T>& dst, const StridedSpan<U>& src, detail::NonDeduced<T> t)
+    {
+        static_assert(std::is_same_v<T, std::remove_const_t<U>>);
+        assert(dst.size() == src.size());
+        lerp<T>(dst.data(), dst.stride(), src.data(), src.stride(), dst.size(), t);
+    }
 
-private:
-    std::unique_ptr<Type> elementType_;
-};
+    template <typename T>
+    std::remove_const_t<T> sum(const StridedSpan<T>& src)
+    {
+        return sum<std::remove_const_t<T>>(src.data(), src.size(), src.stride());
+    }
+
+    template <typename T>
+    std::remove_const_t<T> min(const StridedSpan<T>& src)
+    {
+        return min<std::remove_const_t<T>>(src.data(), src.size(), src.stride());
+    }
+
+    template <typename T>
+    std::remove_const_t<T> max(const StridedSpan<T>& src)
+    {
+        return max<std::remove_const_t<T>>(src.data(), src.size(), src.stride());
+    }
+}
 }
 
 #include <array>
 #include <cstddef>
 #include <iostream>
+#include <numeric>
 
 std::string hex(const std::byte* data, size_t len)
 {
@@ -326,8 +4590,266 @@ std::string hex(const std::byte* data, size_t len)
     return ret;
 }
 
+struct alignas(64) CacheLine {
+    float values[4];
+};
+
+// Compares the layout of runtime structs with the layout of equivalent native structs
+bool checkLayouts()
+{
+    bool ok = true;
+    auto expect = [&ok](const char* name, size_t actual, size_t expected) {
+        if (actual != expected) {
+            std::cerr << "Layout mismatch: " << name << " is " << actual << ", expected "
+                      << expected << "\n";
+            ok = false;
+        }
+    };
+
+    struct Mixed {
+        bool a;
+        double b;
+        bool c;
+        uint16_t d;
+        float e;
+        char f;
+    };
+    rttypes::Struct mixed;
+    mixed.addField("a", rttypes::ConcreteType<bool> {});
+    mixed.addField("b", rttypes::ConcreteType<double> {});
+    mixed.addField("c", rttypes::ConcreteType<bool> {});
+    mixed.addField("d", rttypes::ConcreteType<uint16_t> {});
+    mixed.addField("e", rttypes::Float32 {});
+    mixed.addField("f", rttypes::ConcreteType<char> {});
+    expect("Mixed size", mixed.size(), sizeof(Mixed));
+    expect("Mixed alignment", mixed.alignment(), alignof(Mixed));
+    expect("Mixed::a", mixed.field("a").offset, offsetof(Mixed, a));
+    expect("Mixed::b", mixed.field("b").offset, offsetof(Mixed, b));
+    expect("Mixed::c", mixed.field("c").offset, offsetof(Mixed, c));
+    expect("Mixed::d", mixed.field("d").offset, offsetof(Mixed, d));
+    expect("Mixed::e", mixed.field("e").offset, offsetof(Mixed, e));
+    expect("Mixed::f", mixed.field("f").offset, offsetof(Mixed, f));
+
+    struct Nested {
+        char a;
+        Mixed b;
+        char c;
+        rttypes::VectorData d;
+        uint8_t e;
+    };
+    rttypes::Struct nested;
+    nested.addField("a", rttypes::ConcreteType<char> {});
+    nested.addField("b", mixed);
+    nested.addField("c", rttypes::ConcreteType<char> {});
+    nested.addField("d", rttypes::Vector(rttypes::Float32 {}));
+    nested.addField("e", rttypes::ConcreteType<uint8_t> {});
+    expect("Nested size", nested.size(), sizeof(Nested));
+    expect("Nested alignment", nested.alignment(), alignof(Nested));
+    expect("Nested::a", nested.field("a").offset, offsetof(Nested, a));
+    expect("Nested::b", nested.field("b").offset, offsetof(Nested, b));
+    expect("Nested::c", nested.field("c").offset, offsetof(Nested, c));
+    expect("Nested::d", nested.field("d").offset, offsetof(Nested, d));
+    expect("Nested::e", nested.field("e").offset, offsetof(Nested, e));
+
+    struct OverAligned {
+        uint16_t a;
+        CacheLine b;
+        float c;
+    };
+    rttypes::Struct overAligned;
+    overAligned.addField("a", rttypes::ConcreteType<uint16_t> {});
+    overAligned.addField("b", rttypes::ConcreteType<CacheLine> {});
+    overAligned.addField("c", rttypes::Float32 {});
+    expect("OverAligned size", overAligned.size(), sizeof(OverAligned));
+    expect("OverAligned alignment", overAligned.alignment(), alignof(OverAligned));
+    expect("OverAligned::a", overAligned.field("a").offset, offsetof(OverAligned, a));
+    expect("OverAligned::b", overAligned.field("b").offset, offsetof(OverAligned, b));
+    expect("OverAligned::c", overAligned.field("c").offset, offsetof(OverAligned, c));
+
+    // Sorted by alignment, {bool, double, bool, double} becomes {double, double, bool, bool}
+    struct Sorted {
+        double b;
+        double d;
+        bool a;
+        bool c;
+    };
+    rttypes::Struct sorted;
+    sorted.addField("a", rttypes::ConcreteType<bool> {});
+    sorted.addField("b", rttypes::ConcreteType<double> {});
+    sorted.addField("c", rttypes::ConcreteType<bool> {});
+    sorted.addField("d", rttypes::ConcreteType<double> {});
+    sorted.finalize(rttypes::LayoutPolicy::MinimizePadding);
+    expect("Sorted size", sorted.size(), sizeof(Sorted));
+    expect("Sorted wasted bytes", sorted.wastedBytes(), sizeof(Sorted) - 18);
+    expect("Sorted::a", sorted.field("a").offset, offsetof(Sorted, a));
+    expect("Sorted::b", sorted.field("b").offset, offsetof(Sorted, b));
+    expect("Sorted::c", sorted.field("c").offset, offsetof(Sorted, c));
+    expect("Sorted::d", sorted.field("d").offset, offsetof(Sorted, d));
+
+    struct alignas(64) Padded {
+        float a;
+        float b;
+    };
+    rttypes::Struct padded;
+    padded.addField("a", rttypes::Float32 {});
+    padded.addField("b", rttypes::Float32 {});
+    padded.setMinAlignment(rttypes::cacheLineSize);
+    expect("Padded size", padded.size(), sizeof(Padded));
+    expect("Padded alignment", padded.alignment(), alignof(Padded));
+
+    struct Particle {
+        rttypes::math::Vec3 position;
+        uint8_t kind;
+        rttypes::math::Quat rotation;
+        int16_t lifetime;
+        rttypes::math::Mat4 transform;
+    };
+    rttypes::Struct particle;
+    particle.addField("position", rttypes::Vec3 {});
+    particle.addField("kind", rttypes::UInt8 {});
+    particle.addField("rotation", rttypes::Quat {});
+    particle.addField("lifetime", rttypes::Int16 {});
+    particle.addField("transform", rttypes::Mat4 {});
+    expect("Particle size", particle.size(), sizeof(Particle));
+    expect("Particle alignment", particle.alignment(), alignof(Particle));
+    expect("Particle::position", particle.field("position").offset, offsetof(Particle, position));
+    expect("Particle::kind", particle.field("kind").offset, offsetof(Particle, kind));
+    expect("Particle::rotation", particle.field("rotation").offset, offsetof(Particle, rotation));
+    expect("Particle::lifetime", particle.field("lifetime").offset, offsetof(Particle, lifetime));
+    expect("Particle::transform", particle.field("transform").offset,
+        offsetof(Particle, transform));
+
+    struct Skinned {
+        uint8_t bones[4];
+        float weights[4];
+        rttypes::math::Vec3 offsets[3];
+        bool flag;
+    };
+    rttypes::Struct skinned;
+    skinned.addField("bones", rttypes::FixedArray(rttypes::UInt8 {}, 4));
+    skinned.addField("weights", rttypes::FixedArray(rttypes::Float32 {}, 4));
+    skinned.addField("offsets", rttypes::FixedArray(rttypes::Vec3 {}, 3));
+    skinned.addField("flag", rttypes::Bool {});
+    expect("Skinned size", skinned.size(), sizeof(Skinned));
+    expect("Skinned alignment", skinned.alignment(), alignof(Skinned));
+    expect("Skinned::bones", skinned.field("bones").offset, offsetof(Skinned, bones));
+    expect("Skinned::weights", skinned.field("weights").offset, offsetof(Skinned, weights));
+    expect("Skinned::offsets", skinned.field("offsets").offset, offsetof(Skinned, offsets));
+    expect("Skinned::flag", skinned.field("flag").offset, offsetof(Skinned, flag));
+
+    rttypes::Struct empty;
+    expect("Empty size", empty.size(), 0);
+    expect("Empty alignment", empty.alignment(), 1);
+
+    return ok;
+}
+
+// Compares the SIMD kernels of every instruction set the CPU supports with plain loops. The
+// counts are not multiples of the vector width, so the vector loops and the tails both run. The
+// inputs are small multiples of 1/4, so every result is exact.
+bool checkFloatKernels()
+{
+    using rttypes::simd::Isa;
+    bool ok = true;
+    const auto supported = rttypes::simd::detectIsa();
+    for (const auto isa : { Isa::Sse2, Isa::Avx2, Isa::Avx512 }) {
+        if (isa > supported) {
+            continue;
+        }
+        const auto& kernels = rttypes::simd::floatKernels(isa);
+        for (const size_t count : { 1, 3, 15, 17, 33, 100 }) {
+            auto expect = [&](const char* name, float actual, float expected) {
+                if (actual != expected) {
+                    std::cerr << "Kernel mismatch: " << name << " (isa " << static_cast<int>(isa)
+                              << ", count " << count << ") is " << actual << ", expected "
+                              << expected << "\n";
+                    ok = false;
+                }
+            };
+            // Start one element in, so the arrays are not aligned to the vector width
+            std::vector<float> srcBuf(count + 1), dstBuf(count + 1);
+            const auto src = srcBuf.data() + 1;
+            const auto dst = dstBuf.data() + 1;
+            std::vector<float> ref(count);
+            auto reset = [&]() {
+                for (size_t i = 0; i < count; ++i) {
+                    src[i] = static_cast<float>(static_cast<int>(i * 7 % 13) - 6) * 0.25f;
+                    dst[i] = static_cast<float>(static_cast<int>(i * 5 % 11) - 5) * 0.5f;
+                    ref[i] = dst[i];
+                }
+            };
+            auto compare = [&](const char* name) {
+                for (size_t i = 0; i < count; ++i) {
+                    expect(name, dst[i], ref[i]);
+                }
+            };
+
+            reset();
+            kernels.fill(dst, count, 1.5f);
+            std::fill(ref.begin(), ref.end(), 1.5f);
+            compare("fill");
+
+            reset();
+            kernels.scale(dst, count, -2.0f);
+            for (size_t i = 0; i < count; ++i) {
+                ref[i] *= -2.0f;
+            }
+            compare("scale");
+
+            reset();
+            kernels.axpy(dst, src, count, 0.5f);
+            for (size_t i = 0; i < count; ++i) {
+                ref[i] += 0.5f * src[i];
+            }
+            compare("axpy");
+
+            reset();
+            kernels.add(dst, src, count);
+            for (size_t i = 0; i < count; ++i) {
+                ref[i] += src[i];
+            }
+            compare("add");
+
+            reset();
+            kernels.mul(dst, src, count);
+            for (size_t i = 0; i < count; ++i) {
+                ref[i] *= src[i];
+            }
+            compare("mul");
+
+            reset();
+            kernels.clamp(dst, count, -1.0f, 0.5f);
+            for (size_t i = 0; i < count; ++i) {
+                ref[i] = std::min(std::max(ref[i], -1.0f), 0.5f);
+            }
+            compare("clamp");
+
+            reset();
+            kernels.lerp(dst, src, count, 0.25f);
+            for (size_t i = 0; i < count; ++i) {
+                ref[i] += (src[i] - ref[i]) * 0.25f;
+            }
+            compare("lerp");
+
+            reset();
+            float sum = 0.0f;
+            for (size_t i = 0; i < count; ++i) {
+                sum += src[i];
+            }
+            expect("sum", kernels.sum(src, count), sum);
+            expect("min", kernels.min(src, count), *std::min_element(src, src + count));
+            expect("max", kernels.max(src, count), *std::max_element(src, src + count));
+        }
+    }
+    return ok;
+}
+
 int main()
 {
+    if (!checkLayouts() || !checkFloatKernels()) {
+        return 1;
+    }
+
     rttypes::Struct vec;
     auto f1 = vec.addField("x", rttypes::Float32 {});
     vec.addField("y", rttypes::Float32 {});
@@ -356,9 +4878,10 @@ int main()
     auto startView = vec.view(lineView.fieldPtr("start"));
     startView.field<float>("x") = 12.0f;
     startView.field<float>("y") = 13.0f;
-    auto endView = vec.view(lineView.fieldPtr("end"));
-    endView.field<float>("x") = 20.0f;
-    endView.field<float>("y") = 21.0f;
+    const auto endX = rttypes::FieldPath::resolve(line, "end.x").value();
+    const auto endY = rttypes::FieldPath::resolve(line, "end.y").value();
+    endX.field<float>(lineBuf.data()) = 20.0f;
+    endY.field<float>(lineBuf.data()) = 21.0f;
     lineView.field<rttypes::String::Underlying>("color") = "green";
     line.destruct(lineBuf.data());
 
@@ -376,7 +4899,7 @@ int main()
     }
     std::cout << "\n";
 
-    rttypes::Vector numList(rttypes::Float32 {});
+    rttypes::Vector numList(rttypes::Float32 {}, rttypes::VectorOptions { 64 });
     std::vector<std::byte> listBuf(numList.size());
     numList.construct(listBuf.data());
     auto& listView = numList.view(listBuf.data());
@@ -385,5 +4908,274 @@ int main()
     listView.index<float>(1) = 2.0f;
     listView.index<float>(2) = 3.0f;
     listView.index<float>(3) = 4.0f;
+    std::cout << reinterpret_cast<uintptr_t>(listView.data()) % 64 << "\n";
+    rttypes::simd::axpy<float>(listView, listView, 0.5f);
+    rttypes::simd::clamp<float>(listView, 0.0f, 5.0f);
+    std::cout << rttypes::simd::sum<float>(listView) << " " << rttypes::simd::max<float>(listView)
+              << "\n";
     numList.destruct(listBuf.data());
+
+    // Growing relocates the existing elements instead of copying them
+    rttypes::Vector lineList(line);
+    std::vector<std::byte> lineListBuf(lineList.size());
+    lineList.construct(lineListBuf.data());
+    auto& lineListView = lineList.view(lineListBuf.data());
+    for (size_t i = 0; i < 5; ++i) {
+        lineListView.grow();
+        line.view(lineListView.indexPtr(i)).field<std::string>("color")
+            = "a color that is too long for small buffer optimization #" + std::to_string(i);
+    }
+    std::vector<std::byte> lineListCopyBuf(lineList.size());
+    lineList.copyData(lineListCopyBuf.data(), lineListBuf.data());
+    lineList.destruct(lineListBuf.data());
+    auto& lineListCopy = lineList.view(lineListCopyBuf.data());
+    std::cout << line.view(lineListCopy.indexPtr(3)).field<std::string>("color") << "\n";
+    lineList.destruct(lineListCopyBuf.data());
+
+    // Bounding the growth step bounds the slack of large vectors
+    rttypes::GrowthPolicy boundedGrowth { 1.5, 1 << 20, true };
+    for (const auto& growth : { rttypes::GrowthPolicy {}, boundedGrowth }) {
+        rttypes::Vector particleList(vec, { 1, std::pmr::get_default_resource(), growth });
+        std::vector<std::byte> particleListBuf(particleList.size());
+        particleList.construct(particleListBuf.data());
+        auto& particleListView = particleList.view(particleListBuf.data());
+        for (size_t i = 0; i < 1'100'000; i += 1000) {
+            particleListView.grow(1000);
+        }
+        const auto slack = particleListView.capacity() - particleListView.size();
+        std::cout << slack * vec.size() << "\n";
+        particleList.destruct(particleListBuf.data());
+    }
+
+    // Large vectors of trivially relocatable elements grow by remapping pages instead of copying
+    rttypes::Vector telemetry(rttypes::UInt64 {});
+    std::vector<std::byte> telemetryBuf(telemetry.size());
+    telemetry.construct(telemetryBuf.data());
+    auto& samples = telemetry.view(telemetryBuf.data());
+    for (uint64_t i = 0; i < 4'000'000; ++i) {
+        samples.pushBack(&i);
+    }
+    std::cout << samples.index<uint64_t>(3'999'999) << " "
+              << samples.capacity() * sizeof(uint64_t) % 4096 << "\n";
+    telemetry.destruct(telemetryBuf.data());
+
+    // Moving a vector steals its buffer, instead of copying the elements
+    rttypes::Vector nameList(rttypes::String {});
+    std::vector<std::byte> namesBuf(nameList.size() * 2);
+    nameList.constructN(namesBuf.data(), 2, nameList.size());
+    auto& names = nameList.view(namesBuf.data());
+    auto& otherNames = nameList.view(namesBuf.data() + nameList.size());
+    for (const std::string name : { "anna", "bert", "carl", "dora", "emil" }) {
+        names.pushBack(&name);
+    }
+    const std::string inserted = "zoe";
+    names.insert(1, &inserted, 1);
+    names.erase(2, 2);
+    names.swapRemove(0);
+    const auto namesData = names.data();
+    otherNames = std::move(names);
+    std::cout << names.size() << " " << (otherNames.data() == namesData);
+    for (size_t i = 0; i < otherNames.size(); ++i) {
+        std::cout << " " << otherNames.index<std::string>(i);
+    }
+    std::cout << "\n";
+    nameList.destructN(namesBuf.data(), 2, nameList.size());
+
+    // Elements of chunked vectors never move, so pointers to them survive growth
+    rttypes::ChunkedVector nodeList(line, 4);
+    std::vector<std::byte> nodesBuf(nodeList.size());
+    nodeList.construct(nodesBuf.data());
+    auto& nodes = nodeList.view(nodesBuf.data());
+    auto& firstColor = line.view(nodes.emplaceBack()).field<std::string>("color");
+    firstColor = "the color of the first node, which is too long for small buffers";
+    nodes.resize(1000);
+    std::cout << nodes.chunkCount() << " "
+              << (&line.view(nodes.indexPtr(0)).field<std::string>("color") == &firstColor)
+              << " " << firstColor.size() << "\n";
+    nodeList.destruct(nodesBuf.data());
+
+    // A field of every element of a vector of structs can be iterated like a native array
+    rttypes::Vector vecList(vec);
+    std::vector<std::byte> vecListBuf(vecList.size());
+    vecList.construct(vecListBuf.data());
+    auto& vecListView = vecList.view(vecListBuf.data());
+    vecListView.resize(8);
+    const auto xs = rttypes::StridedSpan<float>::field(vecListView, 0);
+    const auto ys = rttypes::StridedSpan<float>::field(
+        vecListView, rttypes::FieldPath::resolve(vec, "y").value());
+    std::iota(xs.begin(), xs.end(), 1.0f);
+    rttypes::simd::axpy(ys, xs, 2.0f);
+    std::array<float, 8> gathered;
+    ys.gather(gathered.data());
+    std::cout << gathered[7] << " " << rttypes::simd::sum(xs) << " "
+              << *std::max_element(ys.begin(), ys.end()) << "\n";
+    vecList.destruct(vecListBuf.data());
+
+    // All allocations of these instances come from the arena
+    std::pmr::monotonic_buffer_resource levelArena;
+    rttypes::Struct labeledPath;
+    labeledPath.addField("label", rttypes::PmrString(&levelArena));
+    labeledPath.addField("xs", rttypes::Vector(rttypes::Float32 {}, { 1, &levelArena }));
+    std::vector<std::byte> pathBuf(labeledPath.size());
+    labeledPath.construct(pathBuf.data());
+    auto pathView = labeledPath.view(pathBuf.data());
+    pathView.field<std::pmr::string>("label") = "a label that does not fit into a small buffer";
+    pathView.field<rttypes::VectorData>("xs").resize(100);
+    labeledPath.destruct(pathBuf.data());
+    levelArena.release();
+
+    // Per-frame temporaries are destructed and freed all at once
+    rttypes::Arena frameArena;
+    for (size_t frame = 0; frame < 3; ++frame) {
+        for (size_t i = 0; i < 100; ++i) {
+            auto event = line.view(frameArena.create(line));
+            event.field<std::string>("color") = "too long for small buffer optimization";
+            frameArena.create(vec, 16);
+        }
+        frameArena.reset();
+    }
+    std::cout << frameArena.capacity() << "\n";
+
+    // Objects in a pool keep their address and stale handles are detected
+    rttypes::TypedPool linePool(std::make_shared<rttypes::Struct>(line), 4);
+    std::vector<rttypes::PoolHandle> lineHandles;
+    for (size_t i = 0; i < 10; ++i) {
+        lineHandles.push_back(linePool.allocate());
+    }
+    const auto firstLine = linePool.get(lineHandles[0]);
+    linePool.free(lineHandles[3]);
+    const auto reused = linePool.allocate();
+    std::cout << (linePool.get(lineHandles[0]) == firstLine) << " "
+              << (linePool.get(lineHandles[3]) == nullptr) << " " << (reused.index == 3) << " "
+              << linePool.size() << "\n";
+
+    // Components are stored in contiguous columns per archetype
+    rttypes::ArchetypeStorage world;
+    const auto position = world.registerComponent(std::make_shared<rttypes::Struct>(vec));
+    const auto velocity = world.registerComponent(std::make_shared<rttypes::Struct>(vec));
+    for (size_t i = 0; i < 1000; ++i) {
+        const auto entity = world.createEntity();
+        world.addComponent(entity, position);
+        if (i % 2 == 0) {
+            auto vel = vec.view(world.addComponent(entity, velocity));
+            vel.field<float>("x") = 1.0f;
+        }
+    }
+    world.forEachChunk({ position, velocity }, [&](const rttypes::ArchetypeStorage::ChunkView& c) {
+        const auto pos = c.column<float>(position);
+        const auto vel = c.column<float>(velocity);
+        for (size_t i = 0; i < c.size() * 2; ++i) {
+            pos[i] += vel[i] * 0.5f;
+        }
+    });
+    float posSum = 0.0f;
+    world.forEachChunk({ position }, [&](const rttypes::ArchetypeStorage::ChunkView& c) {
+        for (size_t i = 0; i < c.size(); ++i) {
+            posSum += vec.view(c.column<std::byte>(position) + i * vec.size()).field<float>("x");
+        }
+    });
+    std::cout << posSum << "\n";
+
+    // Every field of a struct of arrays vector is a contiguous column
+    rttypes::SoAVector particles(line);
+    std::vector<std::byte> particlesBuf(particles.size());
+    particles.construct(particlesBuf.data());
+    auto& particlesView = particles.view(particlesBuf.data());
+    particlesView.resize(3);
+    particlesView.row(1).field<std::string>("color") = "red";
+    const auto startColumn = particlesView.columnPtr(0);
+    vec.view(startColumn + vec.size() * 2).field<float>("y") = 7.0f;
+    particlesView.grow(100);
+    std::cout << particlesView.row(1).field<std::string>("color") << " "
+              << vec.view(particlesView.row(2).fieldPtr("start")).field<float>("y") << "\n";
+    particles.destruct(particlesBuf.data());
+
+    // Tiled vectors yield blocks with one SIMD register worth of lanes per float field
+    rttypes::TiledVector tiledVecs(vec);
+    std::vector<std::byte> tiledBuf(tiledVecs.size());
+    tiledVecs.construct(tiledBuf.data());
+    auto& tiledView = tiledVecs.view(tiledBuf.data());
+    tiledView.resize(20);
+    for (size_t i = 0; i < tiledView.size(); ++i) {
+        tiledView.row(i).field<float>("x") = static_cast<float>(i);
+    }
+    float tiledSum = 0.0f;
+    for (size_t b = 0; b < tiledView.blockCount(); ++b) {
+        auto block = tiledView.block(b);
+        const auto xs = block.lanes<float>(0);
+        for (size_t lane = 0; lane < block.size(); ++lane) {
+            tiledSum += xs[lane];
+        }
+    }
+    std::cout << tiledView.blockSize() << " " << tiledView.blockCount() << " " << tiledSum << "\n";
+    tiledVecs.destruct(tiledBuf.data());
+
+    // Reordering fields reduces padding
+    rttypes::Struct flags;
+    flags.addField("visible", rttypes::ConcreteType<bool> {});
+    flags.addField("opacity", rttypes::ConcreteType<double> {});
+    flags.addField("enabled", rttypes::ConcreteType<bool> {});
+    flags.addField("weight", rttypes::ConcreteType<double> {});
+    std::cout << flags.size() << " " << flags.wastedBytes() << "\n";
+    flags.finalize(rttypes::LayoutPolicy::MinimizePadding);
+    std::cout << flags.size() << " " << flags.wastedBytes() << "\n";
+
+    // Structurally equal types are interned to the same instance
+    auto& registry = rttypes::TypeRegistry::global();
+    rttypes::Struct otherVec;
+    otherVec.addField("x", rttypes::Float32 {});
+    otherVec.addField("y", rttypes::Float32 {});
+    const auto vecType = registry.intern(vec);
+    const auto vecListType = registry.intern(rttypes::Vector(vec));
+    std::cout << (vecType == registry.intern(otherVec)) << " "
+              << (vecListType == registry.intern(rttypes::Vector(otherVec))) << " "
+              << registry.size() << "\n";
+
+    // Small vectors only allocate once they hold more than their inline capacity
+    rttypes::Struct tagged;
+    tagged.addField("tags", rttypes::SmallVector(rttypes::UInt32 {}, 4));
+    rttypes::Vector taggedList(tagged);
+    std::vector<std::byte> taggedBuf(taggedList.size());
+    taggedList.construct(taggedBuf.data());
+    auto& taggedView = taggedList.view(taggedBuf.data());
+    auto tagsOf = [&](size_t i) -> rttypes::SmallVectorData& {
+        return tagged.view(taggedView.indexPtr(i)).field<rttypes::SmallVectorData>("tags");
+    };
+    for (size_t i = 0; i < 16; ++i) {
+        taggedView.grow();
+        tagsOf(i).resize(i % 6);
+        for (size_t t = 0; t < tagsOf(i).size(); ++t) {
+            tagsOf(i).index<uint32_t>(t) = static_cast<uint32_t>(i * t);
+        }
+    }
+    size_t inlineTags = 0;
+    for (size_t i = 0; i < taggedView.size(); ++i) {
+        inlineTags += tagsOf(i).isInline();
+    }
+    const auto tag = rttypes::FieldPath::resolve(tagged, "tags[3]").value();
+    std::cout << tagged.size() << " " << inlineTags << " "
+              << tag.field<uint32_t>(taggedView.indexPtr(11)) << "\n";
+    taggedList.destruct(taggedBuf.data());
+
+    // Fixed arrays are stored inline and can be indexed by field paths
+    rttypes::Struct inventory;
+    inventory.addField("owner", rttypes::UInt32 {});
+    inventory.addField("slots", rttypes::FixedArray(rttypes::String {}, 8));
+    std::vector<std::byte> inventoryBuf(inventory.size() * 2);
+    inventory.constructN(inventoryBuf.data(), 2, inventory.size());
+    const auto slot3 = rttypes::FieldPath::resolve(inventory, "slots[3]").value();
+    slot3.field<std::string>(inventoryBuf.data()) = "a sword that is too long for small buffers";
+    inventory.destruct(inventoryBuf.data() + inventory.size());
+    inventory.copyData(inventoryBuf.data() + inventory.size(), inventoryBuf.data());
+    std::cout << inventory.size() << " " << slot3.isStatic() << " "
+              << slot3.field<std::string>(inventoryBuf.data() + inventory.size()) << " "
+              << rttypes::FieldPath::resolve(inventory, "slots[8]").has_value() << " "
+              << rttypes::FieldPath::resolve(inventory, "slots[18446744073709551619]").has_value()
+              << "\n";
+    inventory.destructN(inventoryBuf.data(), 2, inventory.size());
+
+    // Primitive types can be looked up by their stable id
+    const auto vec3Type = rttypes::primitiveType(rttypes::PrimitiveId::Vec3);
+    std::cout << (vec3Type == registry.intern(rttypes::Vec3 {})) << " " << vec3Type->size() << " "
+              << vec3Type->hasFlags(rttypes::AllTypeFlags) << "\n";
 }